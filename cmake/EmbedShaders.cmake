@@ -0,0 +1,41 @@
+# Generates a header holding every file in SHADER_DIR as a constexpr table of (name, source) pairs,
+# for EmbeddedShaders.cpp. Run in script mode:
+#   cmake -DSHADER_DIR=<shaders_source> -DOUTPUT=<header> -P EmbedShaders.cmake
+
+file(GLOB_RECURSE SHADER_FILES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*)
+list(SORT SHADER_FILES)
+
+set(DATA "")
+set(TABLE "")
+set(INDEX 0)
+foreach(SHADER_FILE ${SHADER_FILES})
+  file(READ ${SHADER_DIR}/${SHADER_FILE} HEX_CONTENTS HEX)
+  string(LENGTH "${HEX_CONTENTS}" HEX_LENGTH)
+  math(EXPR SIZE "${HEX_LENGTH} / 2")
+
+  # Every byte becomes a \x escape, in string literals of 8 bytes per line.
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "\\\\x\\1" ESCAPED "${HEX_CONTENTS}")
+  string(REGEX REPLACE "((\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f])(\\\\x[0-9a-f][0-9a-f]))"
+    "\\1\"\n\t\t\"" ESCAPED "${ESCAPED}")
+
+  string(APPEND DATA "\t// ${SHADER_FILE}\n\tinline constexpr std::string_view SHADER_${INDEX}{\n\t\t\"${ESCAPED}\", ${SIZE}\n\t};\n")
+  string(APPEND TABLE "\t{ \"${SHADER_FILE}\", embedded_shader_data::SHADER_${INDEX} },\n")
+  math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENTS "// Generated from ${SHADER_DIR} by EmbedShaders.cmake. Do not edit.
+#pragma once
+#include <string_view>
+#include \"EmbeddedShaders.h\"
+
+namespace embedded_shader_data {
+${DATA}}
+
+inline constexpr EmbeddedShader EMBEDDED_SHADER_TABLE[]{
+${TABLE}};
+")
+
+# Only touch the header when it changes, so unrelated shader edits don't force a rebuild.
+file(WRITE ${OUTPUT}.tmp "${CONTENTS}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
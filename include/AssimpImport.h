@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <assimp/postprocess.h>
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshProcessing.h"
+
+struct aiMesh;
+struct aiScene;
+
+const size_t VERTICES_PER_FACE = 3;
+
+// Which processing an import does. assimpFlags are Assimp's own post-processing steps, run while
+// the file is read; the rest are our steps (MeshProcessing.h), which run on every core afterwards.
+struct MeshImportProfile {
+	uint32_t assimpFlags;
+	// Fan-triangulate polygons while converting. Without it, only faces that are already
+	// triangles are kept.
+	bool triangulate;
+	bool joinIdenticalVertices;
+	bool generateNormals;
+	NormalWeighting normalWeighting;
+	// Import the first set of texture coordinates, and generate tangents from them (and normals, if
+	// they weren't generated).
+	bool generateTangents;
+	// Reorder the result for drawing with optimizeMesh, and with overdraw reordering or without.
+	bool optimize;
+	bool optimizeOverdraw;
+	// Cluster the triangles into meshlets for culling, with buildMeshlets (Meshlet.h).
+	bool buildMeshlets;
+	// Append a chain of simplified levels of detail with buildLods (MeshLod.h).
+	bool buildLods;
+	// Measure the cache efficiency and overdraw optimize achieved, for the report. Doesn't change
+	// the result, so it isn't part of importProfileKey.
+	bool analyzeOptimization;
+};
+
+// What every model imported at runtime or by meshcook goes through: only the steps a
+// position-only Vertex3D needs, then optimization for drawing. Importers like the OBJ one emit a
+// vertex per face corner, so joining is what makes the mesh indexed.
+const MeshImportProfile MESH_IMPORT_PROFILE{
+	0, true, true, false, NormalWeighting::Area, false, true, true, true, true, false
+};
+// Assimp's own preset, which this project used to import with. Kept for comparison.
+const MeshImportProfile ASSIMP_MAX_QUALITY_PROFILE{
+	aiProcessPreset_TargetRealtime_MaxQuality, false, false, false, NormalWeighting::Area, false, false, false, false, false, false
+};
+
+// Identifies a profile in mesh cache keys.
+uint64_t importProfileKey(const MeshImportProfile& profile);
+
+// Where the time of an import went, in milliseconds.
+struct MeshImportReport {
+	// Assimp reading the file, including the profile's assimpFlags.
+	double read;
+	// Converting the aiMeshes, and triangulating them.
+	double convert;
+	double joinVertices;
+	double generateNormals;
+	double generateTangents;
+	double optimize;
+	double buildMeshlets;
+	double buildLods;
+	double total;
+	// Set if the profile optimized the mesh; its figures only if it asked for analyzeOptimization too.
+	MeshOptimizationReport optimization;
+};
+
+// The number of triangles in an Assimp mesh: its triangle faces, plus the fan triangulation of its
+// polygons if triangulate is set. Point and line faces are not counted.
+size_t triangleCount(const aiMesh* mesh, bool triangulate);
+
+// Reads the vertices and triangles of an Assimp mesh into the given ranges, which must hold
+// mNumVertices vertices and triangleCount(mesh, triangulate) * VERTICES_PER_FACE indices. Indices
+// are left relative to the mesh's first vertex. If texCoords isn't empty, it must hold mNumVertices
+// too, and gets the mesh's first set of texture coordinates, or zeros if it has none.
+void fromAssimpMesh(const aiMesh* mesh, bool triangulate, std::span<Vertex3D> vertices, std::span<uint32_t> faces,
+	std::span<glm::vec2> texCoords = {});
+
+// Appends every mesh of an imported scene to the given mesh data, one submesh each, converting the
+// meshes in parallel. Meshes without triangles are skipped. Texture coordinates are read too if
+// texCoords is set and any of the meshes has them.
+void fromAssimpScene(const aiScene* scene, bool triangulate, MeshData& mesh, bool texCoords = false);
+
+// Imports a model file with Assimp and appends all of its meshes to the given mesh data, processed
+// as the profile says. Throws with Assimp's error message if the import fails.
+MeshImportReport importMesh(const std::string& path, const MeshImportProfile& profile, MeshData& mesh);
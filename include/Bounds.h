@@ -0,0 +1,27 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "Mesh.h"
+
+// The box and sphere around a whole mesh, and around each of its submeshes, in the same order.
+struct MeshBounds {
+	BoundingVolumes mesh;
+	std::vector<BoundingVolumes> submeshes;
+};
+
+// Works out a mesh's bounds in two passes over its positions, split into blocks that run in
+// parallel and reduce four vertices at a time with SIMD min and max: one for the boxes, and one for
+// the furthest vertex from each box's centre. A submesh's vertices run from its baseVertex to the
+// next submesh's, or to the end. Spheres are centred on their boxes, which is within a few percent
+// of the smallest sphere for most models and much cheaper to find.
+MeshBounds meshBounds(std::span<const Vertex3D> vertices, std::span<const Submesh> submeshes);
+
+// The box around the vertices, with the same reduction. An empty set gets an empty box at the
+// origin.
+BoundingBox boundingBox(std::span<const Vertex3D> vertices);
+
+// The smallest box holding both.
+BoundingBox enclose(const BoundingBox& a, const BoundingBox& b);
+
+// The sphere around the vertices, centred on their bounding box.
+BoundingSphere boundingSphere(std::span<const Vertex3D> vertices);
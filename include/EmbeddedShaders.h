@@ -0,0 +1,16 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A file from shaders_source/, compiled into the executable by the embedshaders build step.
+struct EmbeddedShader {
+	// Path relative to shaders_source/, e.g. "simple_perspective.vert".
+	std::string_view name;
+	std::string_view source;
+};
+
+// Returns the source of the embedded shader with the given name, or nothing if there is none. In
+// builds with SHADER_DISK_OVERRIDE defined, a file of the same name in the shaders directory takes
+// precedence, so shaders can be edited without rebuilding.
+std::optional<std::string> readEmbeddedShader(const std::string& name);
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+
+// The kinds of GL object a GlHandle can own.
+enum class GlObjectType {
+	Shader, Program, Buffer, VertexArray, ProgramPipeline
+};
+
+// Deletes a GL object of the given type. Defined in GlHandle.cpp, so this header doesn't need glad.
+void deleteGlObject(GlObjectType type, uint32_t id);
+
+// Owns a single GL object, deleting it when the handle is destroyed or assigned over. Move-only; a
+// moved-from or default-constructed handle owns nothing, and has id 0.
+template <GlObjectType Type>
+class GlHandle {
+	uint32_t m_id;
+
+public:
+	GlHandle()
+		: m_id(0) {
+	}
+
+	explicit GlHandle(uint32_t id)
+		: m_id(id) {
+	}
+
+	GlHandle(const GlHandle&) = delete;
+	GlHandle& operator=(const GlHandle&) = delete;
+
+	GlHandle(GlHandle&& other) noexcept
+		: m_id(std::exchange(other.m_id, 0)) {
+	}
+
+	GlHandle& operator=(GlHandle&& other) noexcept {
+		if (this != &other) {
+			reset();
+			m_id = std::exchange(other.m_id, 0);
+		}
+		return *this;
+	}
+
+	~GlHandle() {
+		reset();
+	}
+
+	uint32_t get() const {
+		return m_id;
+	}
+
+	explicit operator bool() const {
+		return m_id != 0;
+	}
+
+	void reset() {
+		if (m_id != 0) {
+			deleteGlObject(Type, m_id);
+			m_id = 0;
+		}
+	}
+};
+
+using GlShader = GlHandle<GlObjectType::Shader>;
+using GlProgram = GlHandle<GlObjectType::Program>;
+using GlBuffer = GlHandle<GlObjectType::Buffer>;
+using GlVertexArray = GlHandle<GlObjectType::VertexArray>;
+using GlProgramPipeline = GlHandle<GlObjectType::ProgramPipeline>;
@@ -0,0 +1,40 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+// 64-bit FNV-1a. Pass a previous result as `hash` to hash several pieces of data in sequence.
+constexpr uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+	for (char c : bytes) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// A 64-bit hash of a large buffer, for telling whether a file's contents changed. Reads eight bytes
+// at a time into four independent lanes (the round of xxHash64), so it runs at about the speed
+// memory does, where fnv1a manages a byte every few cycles. Unrelated to fnv1a's values.
+inline uint64_t hashContents(std::span<const std::byte> bytes) {
+	const uint64_t PRIME1{ 0x9e3779b185ebca87ull };
+	const uint64_t PRIME2{ 0xc2b2ae3d27d4eb4full };
+	auto round{ [&](uint64_t lane, uint64_t word) {
+		return std::rotl(lane + word * PRIME2, 31) * PRIME1;
+	} };
+	uint64_t lanes[4]{ PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1 };
+	size_t i{ 0 };
+	for (; i + 32 <= bytes.size(); i += 32) {
+		for (size_t k{ 0 }; k < 4; ++k) {
+			uint64_t word;
+			std::memcpy(&word, bytes.data() + i + k * 8, sizeof(word));
+			lanes[k] = round(lanes[k], word);
+		}
+	}
+	uint64_t hash{ std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18) };
+	hash ^= bytes.size();
+	std::string_view tail{ reinterpret_cast<const char*>(bytes.data() + i), bytes.size() - i };
+	return fnv1a(tail, hash);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+// A whole file mapped read-only into memory, so it can be parsed or copied without first being read
+// into a buffer. Move-only. Throws if the file can't be opened or mapped.
+class MappedFile {
+	const std::byte* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+
+	void close();
+
+public:
+	explicit MappedFile(const std::string& path);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	std::span<const std::byte> bytes() const;
+	std::string_view text() const;
+	size_t size() const;
+
+	// Lets the OS drop the pages of a range of the file that has been read, so a file larger than
+	// memory can be read front to back without all of it staying resident. The range must lie within
+	// bytes(); only whole pages inside it are dropped, and reading them again reads them back in.
+	void release(std::span<const std::byte> range) const;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A range of a mesh's index buffer drawn as one part of the model, such as one of the aiMeshes of a
+// multi-part asset. Indices are relative to baseVertex, so every part keeps its own 0-based indices
+// while sharing the mesh's buffers.
+struct Submesh {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	int32_t baseVertex;
+};
+
+// A simplified version of a whole mesh: the same submeshes, drawn from other ranges of the index
+// buffer (still relative to each submesh's baseVertex), and how far its surface is from the
+// full-detail one, in model units: the furthest any of its vertices is from the plane of a
+// full-detail triangle it replaced (see simplifyMesh).
+struct MeshLod {
+	std::vector<Submesh> submeshes;
+	float error;
+};
+
+struct BoundingSphere {
+	glm::vec3 center;
+	float radius;
+};
+
+// An axis-aligned box, from its lowest corner to its highest.
+struct BoundingBox {
+	glm::vec3 low;
+	glm::vec3 high;
+};
+
+// A box and a sphere around the same vertices.
+struct BoundingVolumes {
+	BoundingBox box;
+	BoundingSphere sphere;
+};
+
+// A cluster of a few dozen neighbouring triangles of one submesh, as a range of the index buffer,
+// with what it takes to cull the cluster as a whole: a sphere around its vertices, and a cone
+// around its triangles' normals, as an axis and the cosine of the cone's half-angle. A cosine of 0
+// or less means the triangles face too many ways for the cluster to ever face away as a whole.
+struct Meshlet {
+	Submesh range;
+	BoundingSphere bounds;
+	glm::vec3 coneAxis;
+	float coneCos;
+};
+
+// A mesh uploaded to the GPU: its vertex array, how many indices to draw from it, and the parts
+// those indices are divided into.
+struct Mesh {
+	uint32_t vao;
+	uint32_t faces;
+	std::vector<Submesh> submeshes;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+	uint32_t indexType;
+	// Takes the positions in the vertex buffer to model space, for meshes uploaded with quantized
+	// positions (MeshQuantization.h). Multiply it into the model matrix.
+	glm::mat4 positionTransform;
+	// Set if the vertex buffer's normals are octahedral (MeshQuantization.h), which vertex shaders
+	// only read correctly when built with OCTAHEDRAL_NORMALS defined.
+	bool octahedralNormals;
+	// Coarser versions of the mesh, from most to least detailed. Level 0, the full-detail mesh, is
+	// submeshes.
+	std::vector<MeshLod> lods;
+	// In model space, for picking a level of detail.
+	BoundingSphere bounds;
+	// Also in model space, for culling and spatial queries: the box around the whole mesh, and both
+	// volumes around each of its submeshes, in the order of submeshes.
+	BoundingBox box;
+	std::vector<BoundingVolumes> submeshBounds;
+	// The full-detail mesh's triangles in clusters, if they were built, for culling parts of it.
+	std::vector<Meshlet> meshlets;
+};
+
+struct Vertex3D {
+	float x;
+	float y;
+	float z;
+};
+
+// A model's geometry on the CPU, between loading it and uploading it with constructMesh.
+struct MeshData {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	std::vector<Submesh> submeshes;
+	// One per vertex, if they were generated; otherwise empty.
+	std::vector<glm::vec3> normals;
+	// One per vertex, from the model's first set of texture coordinates, if they were imported;
+	// otherwise empty.
+	std::vector<glm::vec2> texCoords;
+	// One per vertex, if they were generated; otherwise empty. The direction of increasing u, with
+	// the handedness of the bitangent in w, as MikkTSpace stores them.
+	std::vector<glm::vec4> tangents;
+	// Coarser levels of detail, if they were built. Their indices follow the full-detail mesh's in
+	// faces; steps that rebuild the mesh discard them, so they are built last.
+	std::vector<MeshLod> lods;
+	// Clusters of the full-detail faces, if they were built. Also discarded by steps that rebuild
+	// the mesh.
+	std::vector<Meshlet> meshlets;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshQuantization.h"
+
+// Identifies a cooked mesh: the source file's path, and the import settings used to cook it (see
+// importProfileKey). The file isn't read; cooked meshes record what it was instead (MeshSource).
+uint64_t meshCacheKey(const std::string& path, uint64_t importKey);
+
+// What a mesh was cooked from: the source file's size and modification time, which are checked
+// every time it is opened, and a hash of its contents, only checked when the time differs (after a
+// checkout or a copy, say).
+struct MeshSource {
+	uint64_t size;
+	int64_t modified;
+	uint64_t contentHash;
+};
+
+// Throws if the file can't be read.
+MeshSource meshSource(const std::string& path);
+
+// Vertex and index streams cooked from a model file, the submeshes dividing them, and the levels of
+// detail and meshlets built from them, memory mapped from the mesh cache so they can go straight to
+// glBufferData. Cooked meshes live in a directory named meshcache in the working directory, one
+// file per key. The vertex attributes the import produced (normals, tangents, texture coordinates)
+// are cooked as streams of their own, one entry per vertex, or left out if the import produced
+// none.
+class CookedMesh {
+	MappedFile m_file;
+	uint64_t m_key;
+	MeshSource m_source;
+	std::span<const Vertex3D> m_vertices;
+	std::span<const uint32_t> m_indices;
+	std::span<const Submesh> m_submeshes;
+	std::span<const float> m_lodErrors;
+	// Every level's submeshes, one level after another.
+	std::span<const Submesh> m_lodSubmeshes;
+	std::span<const Meshlet> m_meshlets;
+	std::span<const BoundingVolumes> m_submeshBounds;
+	std::span<const glm::vec3> m_normals;
+	std::span<const glm::vec4> m_tangents;
+	std::span<const glm::vec2> m_texCoords;
+	uint32_t m_maxIndex;
+	BoundingVolumes m_bounds;
+
+	CookedMesh(MappedFile file, uint64_t key, const MeshSource& source, std::span<const Vertex3D> vertices, std::span<const uint32_t> indices,
+		std::span<const Submesh> submeshes, std::span<const float> lodErrors, std::span<const Submesh> lodSubmeshes,
+		std::span<const Meshlet> meshlets, std::span<const BoundingVolumes> submeshBounds, const VertexAttributes& attributes,
+		uint32_t maxIndex, const BoundingVolumes& bounds);
+
+public:
+	// Maps the cooked mesh for this key, if there is one, it was written by this version of the
+	// program, and it was cooked from the source file as it is now.
+	static std::optional<CookedMesh> open(uint64_t key, const std::string& sourcePath);
+	// Writes a cooked mesh for later runs to open. Failures are ignored; the mesh is just cooked
+	// again next time. Each of the attributes must be empty or have one entry per vertex.
+	static void store(uint64_t key, const MeshSource& source, std::span<const Vertex3D> vertices,
+		std::span<const uint32_t> indices, std::span<const Submesh> submeshes, std::span<const MeshLod> lods,
+		std::span<const Meshlet> meshlets, const VertexAttributes& attributes);
+
+	// The same, for cooked meshes at a path of their own, such as the ones meshcook writes into the
+	// build's models directory. openFile accepts any key; write returns false if it failed.
+	static std::optional<CookedMesh> openFile(const std::string& path);
+	static bool write(const std::string& path, uint64_t key, const MeshSource& source,
+		std::span<const Vertex3D> vertices, std::span<const uint32_t> indices, std::span<const Submesh> submeshes,
+		std::span<const MeshLod> lods, std::span<const Meshlet> meshlets, const VertexAttributes& attributes);
+
+	// The meshCacheKey of the source the mesh was cooked from.
+	uint64_t key() const;
+	// Whether the file at sourcePath is still what the mesh was cooked from: the same size and time,
+	// or the same size and contents.
+	bool cookedFrom(const std::string& sourcePath) const;
+
+	std::span<const Vertex3D> vertices() const;
+	std::span<const uint32_t> indices() const;
+	std::span<const Submesh> submeshes() const;
+	std::vector<MeshLod> lods() const;
+	std::span<const Meshlet> meshlets() const;
+	// Empty spans for the attributes the mesh doesn't have.
+	VertexAttributes attributes() const;
+
+	// Worked out when the mesh was cooked (see meshBounds): the largest index, the box and sphere
+	// around the vertices, and around each submesh's, in the order of submeshes.
+	uint32_t maxIndex() const;
+	BoundingVolumes bounds() const;
+	std::span<const BoundingVolumes> submeshBounds() const;
+
+	// Lets the OS drop the pages of part of any stream once it has been uploaded,
+	// so uploading a mesh a piece at a time keeps only about a piece of it in memory (see
+	// MappedFile::release). The streams stay readable.
+	void release(std::span<const std::byte> range) const;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Mesh.h"
+
+// Simplifies a triangle list with quadric error metrics (Garland and Heckbert), by collapsing
+// edges onto one of their existing vertices, so the result indexes the same vertices as the input.
+// Vertices on open borders are kept in place, so holes and seams don't grow. Stops at
+// targetIndexCount, or earlier if no edge can be collapsed without flipping a triangle. error is
+// set to how far collapses have moved the surface: the largest distance from a kept vertex to the
+// plane of any full-detail triangle around the vertices collapsed onto it, in model units.
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	size_t targetIndexCount, float& error);
+
+// Appends a chain of levels of detail to the mesh, each with about half the triangles of the one
+// before, until a level stops shrinking or gets down to LOD_MIN_TRIANGLES. Submeshes are
+// simplified in parallel, and each level's triangles are ordered for the vertex cache. A mesh
+// without submeshes is given one, since its faces no longer all belong to the full mesh.
+void buildLods(MeshData& mesh);
+
+const size_t MAX_LODS = 8;
+const size_t LOD_MIN_TRIANGLES = 64;
+
+// Level selection thresholds, in pixels.
+struct LodSettings {
+	// The largest error on screen a level may show.
+	float maxPixelError;
+	// Meshes covering less than this (as the diameter of their bounding sphere) aren't drawn.
+	float cullPixelSize;
+};
+
+const LodSettings DEFAULT_LOD_SETTINGS{ 1.0f, 2.0f };
+const size_t LOD_CULLED = SIZE_MAX;
+
+// Picks the coarsest level of detail whose error would cover at most maxPixelError pixels, from
+// how large the mesh's bounding sphere projects: 0 for the full mesh, i for lods[i - 1], or
+// LOD_CULLED if the mesh is too small to draw. The projection must be a perspective one.
+size_t selectLod(const Mesh& mesh, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight,
+	const LodSettings& settings = DEFAULT_LOD_SETTINGS);
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Mesh.h"
+
+// How well a mesh's triangle order uses the GPU's post-transform vertex cache, simulated as a FIFO
+// of VERTEX_CACHE_ANALYSIS_SIZE entries.
+struct VertexCacheStats {
+	// Average cache miss ratio: vertices transformed per triangle. 0.5 is ideal for a large
+	// regular grid, 3 is the worst case.
+	float acmr;
+	// Average transform to vertex ratio: vertices transformed per vertex drawn. 1 is ideal.
+	float atvr;
+};
+
+// Before and after figures for optimizeMesh. Overdraw is fragments shaded per pixel covered,
+// averaged over six axis-aligned views; 1 is ideal. The cache and overdraw figures are only
+// measured if optimizeMesh was asked to analyze, and are zero otherwise.
+struct MeshOptimizationReport {
+	bool analyzed;
+	VertexCacheStats cacheBefore;
+	VertexCacheStats cacheAfter;
+	float overdrawBefore;
+	float overdrawAfter;
+	size_t degenerateTriangles;
+};
+
+const size_t VERTEX_CACHE_ANALYSIS_SIZE = 16;
+
+// Reorders a mesh for drawing, each submesh on its own core:
+// - triangles with repeated corners or no area are removed;
+// - triangles are ordered for the post-transform vertex cache, with Forsyth's algorithm;
+// - if optimizeOverdraw is set, runs of those triangles are then sorted to draw outward-facing
+//   parts first (Sander et al.'s view-independent clusters), which reduces overdraw from any
+//   view while keeping most of the cache efficiency;
+// - vertices are renumbered in order of first use, so vertex fetch reads memory sequentially.
+//   Vertices no triangle uses are dropped.
+// If analyze is set, the mesh's cache efficiency and overdraw are also measured before and after.
+// Overdraw is measured by rasterizing the whole mesh six times, so this is for reports and
+// benchmarks, not for every load.
+MeshOptimizationReport optimizeMesh(MeshData& mesh, bool optimizeOverdraw, bool analyze = false);
+
+// Forsyth's greedy ordering, on its own: always emits the remaining triangle whose vertices score
+// best, looking only at triangles around the vertices in a simulated LRU cache. Indices must be
+// below vertexCount, and triangles must not repeat a corner.
+std::vector<uint32_t> optimizeVertexCache(std::span<const uint32_t> faces, size_t vertexCount);
+
+VertexCacheStats analyzeVertexCache(const MeshData& mesh);
+float analyzeOverdraw(const MeshData& mesh);
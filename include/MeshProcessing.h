@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Processing steps for imported geometry, run on every core. Each submesh is expected to own a
+// contiguous range of vertices starting at its baseVertex, as it does after an import; a mesh
+// without submeshes is treated as a single one.
+
+// How alike weldVertices requires vertices to be. Each attribute is snapped to a grid of the given
+// cell size and compared exactly, so a tolerance of 0 only merges identical values, and close
+// values on either side of a cell boundary aren't merged.
+struct WeldSettings {
+	float positionTolerance;
+	// Whether normals, if the mesh has them, must match too. If not, each merged vertex keeps the
+	// normal of the first vertex of its group.
+	bool matchNormals;
+	float normalTolerance;
+};
+
+const WeldSettings EXACT_WELD{ 0, false, 0 };
+
+// Merges alike vertices within each submesh, and rewrites the indices to match, keeping vertices in
+// order of first use. Texture coordinates, if the mesh has them, always have to match exactly, so
+// seams are kept. For unindexed or poorly indexed geometry, such as triangle soups from scanners.
+// Vertices are hashed into one open-addressing table shared by every core, so a single huge
+// submesh welds in parallel too; each group keeps its lowest-numbered vertex, so the result
+// doesn't depend on the threads.
+void weldVertices(MeshData& mesh, const WeldSettings& settings);
+
+// Merges vertices of a submesh that have exactly the same position: weldVertices with EXACT_WELD.
+// Normals, if present, are kept from the first of each merged group, so join before generating them.
+void joinIdenticalVertices(MeshData& mesh);
+
+// How much each triangle around a vertex counts towards its normal: by the triangle's area, or by
+// its angle at the vertex, which doesn't change when the triangles around a vertex are split up
+// differently.
+enum class NormalWeighting {
+	Area, Angle
+};
+
+// Computes a smooth normal for every vertex: the normalized, weighted sum of the normals of the
+// triangles around it. Vertices that belong to no triangle get a zero normal. Triangles are
+// processed in blocks on every core, and the sums are gathered per vertex with SIMD.
+void generateNormals(MeshData& mesh, NormalWeighting weighting = NormalWeighting::Area);
+
+// Computes a tangent for every vertex from its texture coordinates, as MikkTSpace does: each
+// triangle's direction of increasing u, projected onto the plane of the vertex's normal and
+// normalized, then weighted by the triangle's angle at the vertex in that plane. The bitangent's
+// handedness, from the triangles' orientation in texture space, goes in w, so a shader rebuilds it
+// as w * cross(normal, tangent). Unlike MikkTSpace, vertices aren't split where the triangles
+// around them disagree: a vertex takes the orientation most of its angle has, and ignores the
+// other triangles. weldVertices keeps UV seams split already. Generates area-weighted normals
+// first if the mesh has none, and does nothing if it has no texture coordinates. Runs like
+// generateNormals.
+void generateTangents(MeshData& mesh);
+
+// Helpers for writing steps that rebuild each submesh on its own.
+
+// The submeshes to process: the mesh's own, or one covering the whole mesh.
+std::vector<Submesh> submeshesOf(const MeshData& mesh);
+// The number of vertices each submesh owns: up to the next submesh's first vertex, or the end of
+// the mesh.
+std::vector<size_t> submeshVertexCounts(const MeshData& mesh, const std::vector<Submesh>& submeshes);
+
+// A submesh as rebuilt by a step: its new indices, and the vertices it keeps in their new order, as
+// indices into its old vertex range.
+struct RebuiltSubmesh {
+	std::vector<uint32_t> faces;
+	std::vector<uint32_t> vertices;
+};
+
+// Replaces the mesh's vertices, their attributes and faces with the rebuilt submeshes (one per entry of
+// submeshesOf), packed one after another, and updates its submesh ranges to match. Levels of detail
+// and meshlets are discarded.
+void repackSubmeshes(MeshData& mesh, const std::vector<Submesh>& submeshes,
+	const std::vector<RebuiltSubmesh>& rebuilt);
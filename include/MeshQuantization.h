@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Mesh.h"
+
+// A position stored as three normalized 16-bit integers, padded to 8 bytes so every vertex attribute
+// stays 4-byte aligned.
+struct QuantizedPosition {
+	uint16_t x;
+	uint16_t y;
+	uint16_t z;
+	uint16_t padding;
+};
+
+// A unit vector folded onto an octahedron and unfolded into a square, as two normalized 16-bit
+// integers.
+struct OctahedralNormal {
+	int16_t x;
+	int16_t y;
+};
+
+// A tangent and its handedness as four normalized 16-bit integers.
+struct ShortTangent {
+	int16_t x;
+	int16_t y;
+	int16_t z;
+	int16_t w;
+};
+
+// Maps each axis of a mesh's bounds onto the full range of a normalized 16-bit integer. The GPU
+// reads quantized positions as [0, 1], and transform() takes them back to model space.
+struct PositionQuantization {
+	glm::vec3 offset;
+	glm::vec3 scale;
+
+	glm::mat4 transform() const;
+};
+
+PositionQuantization positionQuantization(std::span<const Vertex3D> vertices);
+// The quantization for a box, for meshes whose bounds are known before all of their vertices are.
+PositionQuantization positionQuantization(const BoundingBox& box);
+QuantizedPosition quantizePosition(const Vertex3D& vertex, const PositionQuantization& quantization);
+glm::vec3 dequantizePosition(const QuantizedPosition& position, const PositionQuantization& quantization);
+OctahedralNormal encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const OctahedralNormal& normal);
+ShortTangent encodeTangent(const glm::vec4& tangent);
+
+// Which vertex attributes constructMesh stores in compact form. Tangents are stored in 16 bits
+// along with normals.
+struct VertexEncoding {
+	bool quantizePositions;
+	bool octahedralNormals;
+};
+
+const VertexEncoding FULL_PRECISION_ENCODING{ false, false };
+// 8 bytes of position, 4 of normal and 8 of tangent, against 12, 12 and 16.
+const VertexEncoding COMPACT_ENCODING{ true, true };
+
+// A mesh's vertex attributes besides positions, one per vertex, or empty if it doesn't have them.
+// Their locations are declared in vertex_attributes.glsl.
+struct VertexAttributes {
+	std::span<const glm::vec3> normals;
+	std::span<const glm::vec4> tangents;
+	std::span<const glm::vec2> texCoords;
+};
+
+// A mesh's interleaved vertex stream, encoded for upload.
+struct EncodedVertices {
+	std::vector<std::byte> data;
+	uint32_t stride;
+	// Where each vertex's normal, tangent and texture coordinates start, for the attributes the mesh
+	// has.
+	uint32_t normalOffset;
+	uint32_t tangentOffset;
+	uint32_t texCoordOffset;
+	// Model space from the stored position: the dequantization transform, or the identity.
+	glm::mat4 positionTransform;
+	// The largest error encoding introduced: per axis, in model units, and in degrees.
+	float positionError;
+	float normalError;
+};
+
+// Interleaves positions with whichever other attributes there are, in the given encoding, measuring
+// the error in positions and normals as it goes. Texture coordinates are always stored as floats.
+// Runs on every core.
+EncodedVertices encodeVertices(std::span<const Vertex3D> vertices, const VertexAttributes& attributes,
+	VertexEncoding encoding);
+// The same, quantizing positions to the given bounds rather than the vertices' own, so a mesh can be
+// encoded a piece at a time.
+EncodedVertices encodeVertices(std::span<const Vertex3D> vertices, const VertexAttributes& attributes,
+	VertexEncoding encoding, const PositionQuantization& quantization);
+
+// Whether every index fits in 16 bits. Indices are relative to each submesh's base vertex, so a mesh
+// can use 16-bit indices as long as none of its submeshes has more than 65536 vertices.
+bool fitsShortIndices(std::span<const uint32_t> faces);
+std::vector<uint16_t> narrowIndices(std::span<const uint32_t> faces);
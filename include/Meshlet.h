@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+const size_t MESHLET_MIN_TRIANGLES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 128;
+
+// Splits each submesh's triangles into meshlets of up to MESHLET_MAX_TRIANGLES triangles, grown
+// from neighbour to neighbour, and ending early (past MESHLET_MIN_TRIANGLES) when the next triangle
+// would turn too far from the rest. Triangles are reordered so each meshlet is a range of the index
+// buffer, with Forsyth's order inside it, and neighbouring visible ones draw as a single range.
+// Meshlets start in the order their first triangles were in, so run it after optimizeMesh, and
+// before buildLods. Submeshes are split in parallel.
+void buildMeshlets(MeshData& mesh);
+
+// What cullMeshlets left out, and how many indices it left to draw.
+struct MeshletCullStats {
+	size_t outsideFrustum;
+	size_t facingAway;
+	size_t indices;
+};
+
+// Fills visible with the ranges of the mesh's index buffer covering the meshlets that may be seen:
+// the ones whose spheres are in the view frustum, and whose triangles don't all face away from the
+// camera. Neighbouring ranges are merged. Cone tests are only exact if modelView scales uniformly.
+MeshletCullStats cullMeshlets(const Mesh& mesh, const glm::mat4& modelView, const glm::mat4& projection,
+	std::vector<Submesh>& visible);
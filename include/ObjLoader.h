@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Appends the positions and triangles of a Wavefront OBJ file to the given lists, in the form
+// constructMesh takes. A fast path for plain OBJ scans that don't need Assimp's post-processing:
+// the file is memory mapped, split into line-aligned chunks, and the chunks are parsed on separate
+// threads. Polygons are triangulated as fans, every object in the file is merged into one mesh,
+// and texture coordinates, normals, groups and materials are ignored. Throws with the file name
+// and byte offset of the first malformed line.
+void loadObj(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces);
+
+// How many vertices, and triangle indices, an OBJ file holds.
+struct ObjCounts {
+	size_t vertices;
+	size_t faces;
+};
+
+using ObjSizeCallback = std::function<void(const ObjCounts& counts)>;
+using ObjChunkCallback = std::function<void(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces)>;
+
+// Reads an OBJ file the way loadObj does, but about windowSize bytes of it at a time, for files too
+// large to hold in memory once parsed. A first pass counts the file's vertices and triangles and
+// passes them to sized, so buffers for the whole mesh can be made up front; then each window's
+// vertices and triangles are parsed and passed to chunk, in the order they are in the file, and the
+// window's pages are released before the next is read. Indices count from the file's first vertex,
+// and may refer to vertices in windows still to come.
+void streamObj(const std::string& path, size_t windowSize, const ObjSizeCallback& sized,
+	const ObjChunkCallback& chunk);
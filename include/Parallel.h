@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Runs work(i) for every i in [0, count), spread over up to one thread per hardware thread, and
+// rethrows the first error any of them hit once all are done. Items are handed out one at a time,
+// so uneven items (a scene's meshes, say) still balance. Runs inline when there is only one item.
+template <typename Work>
+void parallelFor(size_t count, Work work) {
+	if (count <= 1) {
+		if (count == 1) {
+			work(size_t{ 0 });
+		}
+		return;
+	}
+
+	std::atomic<size_t> next{ 0 };
+	std::exception_ptr error{};
+	std::atomic_flag failed{};
+	auto run{ [&] {
+		for (size_t i{ next++ }; i < count; i = next++) {
+			try {
+				work(i);
+			}
+			catch (...) {
+				if (!failed.test_and_set()) {
+					error = std::current_exception();
+				}
+			}
+		}
+	} };
+	{
+		size_t threads{ std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency())) };
+		std::vector<std::jthread> workers;
+		workers.reserve(threads);
+		for (size_t i{ 0 }; i < threads; ++i) {
+			workers.emplace_back(run);
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
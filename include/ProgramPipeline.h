@@ -0,0 +1,38 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "GlHandle.h"
+#include "ShaderProgram.h"
+
+// Draws with a vertex stage and a fragment stage taken from separate single-stage programs (see
+// ShaderProgram::loadStage), so each shader is linked once however many combinations are drawn,
+// and swapping one stage doesn't touch the other. Needs GL 4.1 or ARB_separate_shader_objects;
+// check ShaderProgram::separableSupported() first.
+class ProgramPipeline {
+	// A program attached to one stage of the pipeline, and the generation it had when attached,
+	// so a program that has since been relinked (e.g. by ShaderReloader) is attached again.
+	struct AttachedStage {
+		ShaderProgram* program;
+		uint32_t generation;
+	};
+
+	GlProgramPipeline m_pipeline;
+	std::array<AttachedStage, 2> m_stages;
+
+	void attach(ShaderStage stage);
+
+public:
+	ProgramPipeline();
+
+	// Uses the given separable program for the stage it was built for. The program must outlive
+	// the pipeline, or be replaced by another.
+	void useStage(ShaderProgram& program);
+	ShaderProgram* stage(ShaderStage stage) const;
+
+	// Makes the pipeline current, in place of any program activated with ShaderProgram::activate.
+	void activate();
+
+	// Asks the driver whether the current stages can be drawn with, throwing with its log if not.
+	// Slow; for debugging only.
+	void validate();
+};
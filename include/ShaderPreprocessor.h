@@ -0,0 +1,30 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Preprocessor symbols to compile a shader with, e.g. { { "INSTANCED", "1" } }. Kept sorted, so the
+// same set always produces the same source (and hits the same cache entries).
+using ShaderDefines = std::map<std::string, std::string>;
+
+// Returns the contents of the shader file at the given path, or nothing if it doesn't exist.
+using ShaderFileReader = std::function<std::optional<std::string>(const std::string& path)>;
+
+struct PreprocessedShader {
+	// GLSL ready to pass to glShaderSource.
+	std::string source;
+	// Every file the source was built from: the shader itself, then its includes.
+	std::vector<std::string> files;
+};
+
+// Reads a shader file from disk.
+std::optional<std::string> readShaderFile(const std::string& path);
+
+// Expands `#include "file"` directives (relative to the including file, each file at most once),
+// and inserts a #define for each of the given defines after the #version line, or at the top of a
+// source without one. #line directives are emitted around each include, so compile errors point at
+// the right line; the file a line came from is the index of that file in PreprocessedShader::files.
+PreprocessedShader preprocessShader(const std::string& path, const ShaderDefines& defines,
+	const ShaderFileReader& readFile = readShaderFile);
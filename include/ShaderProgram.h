@@ -1,22 +1,297 @@
 #pragma once
 #include <glm/ext.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "GlHandle.h"
+#include "Hash.h"
+#include "ShaderPreprocessor.h"
+
+// Counters describing how a ShaderProgram's uniform cache has been used.
+struct UniformCacheStats {
+	// Lookups served from the table built after linking.
+	uint64_t hits;
+	// Lookups that had to fall back to glGetUniformLocation.
+	uint64_t misses;
+	// glUniform* calls that were actually issued.
+	uint64_t uploads;
+	// glUniform* calls skipped because the value matched the last upload.
+	uint64_t skippedUploads;
+};
+
+// How long the last ShaderProgram::load spent blocked in the driver, and whether the program came from the on-disk
+// program binary cache rather than a compile from source.
+struct ShaderLoadReport {
+	double milliseconds;
+	bool fromBinaryCache;
+};
+
+enum class ShaderStage {
+	Vertex, Fragment
+};
+
+// A vertex and fragment shader to be linked together, for ShaderProgram::loadAll.
+struct ShaderSourcePaths {
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+	ShaderDefines defines;
+};
+
+// The GLSL types a uniform can have, as far as ShaderProgram is concerned. Samplers are set with
+// an int32_t texture unit.
+enum class UniformType : uint8_t {
+	Unknown, Bool, Int, Float, Vec2, Vec3, Vec4, Mat2, Mat3, Mat4, Sampler
+};
+
+// A uniform whose name, location and type were read from the shader module, rather than asked of
+// the driver (which can't reflect SPIR-V uniforms by name).
+struct DeclaredUniform {
+	std::string name;
+	int32_t location;
+	UniformType type;
+};
+
+// A member of a uniform block, as reflected after linking. Offsets are in bytes from the start of
+// the block.
+struct UniformBlockMember {
+	std::string name;
+	UniformType type;
+	int32_t arraySize;
+	int32_t offset;
+};
+
+// A uniform block as reflected after linking, with its members in offset order.
+struct UniformBlockInfo {
+	std::string name;
+	uint32_t index;
+	uint32_t binding;
+	int32_t dataSize;
+	std::vector<UniformBlockMember> members;
+};
+
+template <typename T> struct UniformTypeOf;
+template <> struct UniformTypeOf<bool> { static constexpr UniformType value{ UniformType::Bool }; };
+template <> struct UniformTypeOf<int32_t> { static constexpr UniformType value{ UniformType::Int }; };
+template <> struct UniformTypeOf<float> { static constexpr UniformType value{ UniformType::Float }; };
+template <> struct UniformTypeOf<glm::vec2> { static constexpr UniformType value{ UniformType::Vec2 }; };
+template <> struct UniformTypeOf<glm::vec3> { static constexpr UniformType value{ UniformType::Vec3 }; };
+template <> struct UniformTypeOf<glm::vec4> { static constexpr UniformType value{ UniformType::Vec4 }; };
+template <> struct UniformTypeOf<glm::mat2> { static constexpr UniformType value{ UniformType::Mat2 }; };
+template <> struct UniformTypeOf<glm::mat3> { static constexpr UniformType value{ UniformType::Mat3 }; };
+template <> struct UniformTypeOf<glm::mat4> { static constexpr UniformType value{ UniformType::Mat4 }; };
+
+// A string literal that can be used as a template argument, as in Uniform<glm::mat4, "model">.
+template <size_t N>
+struct FixedString {
+	char chars[N];
+
+	constexpr FixedString(const char (&str)[N]) {
+		std::copy_n(str, N, chars);
+	}
+
+	constexpr std::string_view view() const {
+		return { chars, N - 1 };
+	}
+};
+
+// Usable at compile time, to hash the names of Uniform handles.
+constexpr uint64_t hashUniformName(std::string_view name) {
+	return fnv1a(name);
+}
+
+class ShaderProgram;
+class ProgramPipeline;
+
+// A typed handle to a uniform whose name and type are known at compile time. The handle resolves
+// its slot in the program's uniform table when constructed, checking the GLSL type reported by the
+// driver against T, and only re-resolves if the program it is used with has been relinked. Setting
+// a value through a handle is a single indexed store into that table.
+template <typename T, FixedString Name>
+class Uniform {
+	mutable uint32_t m_slot;
+	mutable uint32_t m_generation;
+
+public:
+	using ValueType = T;
+	static constexpr std::string_view name{ Name.view() };
+	static constexpr uint64_t hash{ hashUniformName(name) };
+	static constexpr UniformType type{ UniformTypeOf<T>::value };
+
+	explicit Uniform(ShaderProgram& program);
+
+	uint32_t slot(ShaderProgram& program) const;
+};
+
 class ShaderProgram {
-	uint32_t m_programId;
+	// A uniform location resolved once after linking, plus a CPU-side copy of the last value
+	// uploaded to it.
+	struct UniformSlot {
+		int32_t location;
+		UniformType type;
+		bool hasValue;
+		std::array<std::byte, sizeof(glm::mat4)> value;
+	};
+
+	// Allows the uniform table to be searched with a string_view, so callers passing string
+	// literals don't allocate a std::string for every lookup.
+	struct UniformNameHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const {
+			return std::hash<std::string_view>{}(name);
+		}
+	};
+
+	GlProgram m_program;
+	// Changes every time any program is linked, so Uniform handles can tell when to re-resolve.
+	uint32_t m_generation;
+	std::vector<UniformSlot> m_uniforms;
+	std::unordered_map<std::string, uint32_t, UniformNameHash, std::equal_to<>> m_uniformIndex;
+	// (name hash, slot) pairs sorted by hash, for resolving Uniform handles.
+	std::vector<std::pair<uint64_t, uint32_t>> m_uniformHashes;
+	UniformCacheStats m_uniformStats;
+	ShaderLoadReport m_loadReport;
+	std::vector<UniformBlockInfo> m_uniformBlocks;
+	// Uniforms of a program loaded from SPIR-V, to reflect in place of querying the driver.
+	std::vector<DeclaredUniform> m_declaredUniforms;
+	// Set for a single-stage program built to be combined with others in a ProgramPipeline.
+	std::optional<ShaderStage> m_separableStage;
+	// The program binary this program was loaded from or stored as, or NO_BINARY_CACHE.
+	uint64_t m_binaryKey;
+
+	// Shader objects of a program whose link has been submitted but not yet checked. The shaders
+	// are owned here if the program compiled them itself, or by whoever passed them to linkAsync.
+	// A separable program only has the shader of its own stage; the other is 0.
+	struct PendingLink {
+		uint32_t vertex;
+		uint32_t fragment;
+		GlShader ownedVertex;
+		GlShader ownedFragment;
+		uint64_t cacheKey;
+	};
+	std::optional<PendingLink> m_pendingLink;
+
+	void createProgram(std::optional<ShaderStage> separableStage);
+	void reflectUniforms();
+	void reflectUniformBlocks();
+	void addUniform(std::string uniformName, int32_t location, UniformType type);
+	uint32_t findUniform(std::string_view uniformName);
+	template <typename T>
+	UniformSlot* updateUniform(uint32_t slot, const T& value);
+
+	void setUniformSlot(uint32_t slot, bool value);
+	void setUniformSlot(uint32_t slot, int32_t value);
+	void setUniformSlot(uint32_t slot, float value);
+	void setUniformSlot(uint32_t slot, const glm::vec2& value);
+	void setUniformSlot(uint32_t slot, const glm::vec3& value);
+	void setUniformSlot(uint32_t slot, const glm::vec4& value);
+	void setUniformSlot(uint32_t slot, const glm::mat2& value);
+	void setUniformSlot(uint32_t slot, const glm::mat3& value);
+	void setUniformSlot(uint32_t slot, const glm::mat4& value);
+
+	template <typename T, FixedString Name> friend class Uniform;
+	uint32_t bindUniform(uint64_t hash, UniformType type, std::string_view uniformName);
+	friend class ProgramPipeline;
 
 public:
 	ShaderProgram();
-	void load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+	ShaderProgram(ShaderProgram&&) = default;
+	ShaderProgram& operator=(ShaderProgram&&) = default;
+
+	void load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+		const ShaderDefines& defines = {});
+	void loadAsync(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+		const ShaderDefines& defines = {});
+	void loadEmbedded(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+		const ShaderDefines& defines = {});
+	void loadEmbeddedAsync(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+		const ShaderDefines& defines = {});
+	void loadSourceAsync(const std::string& vertexCode, const std::string& fragmentCode);
+
+	// The pieces loadSourceAsync is made of, for callers that manage shader objects themselves.
+	// Linking with NO_BINARY_CACHE as the key stores no program binary.
+	static constexpr uint64_t NO_BINARY_CACHE{ 0 };
+	static uint64_t binaryCacheKey(const std::string& vertexCode, const std::string& fragmentCode);
+	bool loadBinary(uint64_t cacheKey);
+	uint64_t binaryKey() const;
+	static void discardBinary(uint64_t cacheKey);
+	static GlShader compileShaderAsync(ShaderStage stage, const std::string& code);
+	void linkAsync(uint32_t vertexShader, uint32_t fragmentShader, uint64_t cacheKey);
+	static std::vector<ShaderProgram> loadAll(const std::vector<ShaderSourcePaths>& sources);
+	bool isReady() const;
+	void finishLoad();
+
+	// Single-stage ("separable") programs, for combining in a ProgramPipeline. Needs GL 4.1 or
+	// ARB_separate_shader_objects. The shader is compiled with SEPARABLE_PROGRAM defined.
+	static bool separableSupported();
+	static std::string separableSource(const std::string& code);
+	void loadStage(ShaderStage stage, const std::string& shaderPath, const ShaderDefines& defines = {});
+	void loadStageAsync(ShaderStage stage, const std::string& shaderPath, const ShaderDefines& defines = {});
+	void loadStageSourceAsync(ShaderStage stage, const std::string& code);
+	bool loadStageBinary(ShaderStage stage, uint64_t cacheKey);
+	void linkStageAsync(ShaderStage stage, uint32_t shader, uint64_t cacheKey);
+	std::optional<ShaderStage> separableStage() const;
+
+	// Programs linked from SPIR-V modules compiled ahead of time by the spirv build target, which
+	// skips the driver's GLSL front end. Needs GL 4.6 or ARB_gl_spirv. Only the default
+	// permutation is available, since defines are applied before compiling.
+	static bool spirvSupported();
+	static std::vector<uint32_t> readSpirvModule(const std::string& path);
+	void loadSpirv(const std::string& vertexModulePath, const std::string& fragmentModulePath);
+	void loadSpirvAsync(const std::string& vertexModulePath, const std::string& fragmentModulePath);
+	static uint64_t binaryCacheKey(std::span<const uint32_t> vertexModule, std::span<const uint32_t> fragmentModule);
+	static GlShader specializeShaderAsync(ShaderStage stage, std::span<const uint32_t> module);
+
+	void unload();
+	bool isLoaded() const;
 
 	void activate();
+	bool isActive() const;
+
+	void setUniform(std::string_view uniformName, bool value);
+	void setUniform(std::string_view uniformName, int32_t value);
+	void setUniform(std::string_view uniformName, float value);
+	void setUniform(std::string_view uniformName, const glm::vec2& value);
+	void setUniform(std::string_view uniformName, const glm::vec3& value);
+	void setUniform(std::string_view uniformName, const glm::vec4& value);
+	void setUniform(std::string_view uniformName, const glm::mat2& value);
+	void setUniform(std::string_view uniformName, const glm::mat3& value);
+	void setUniform(std::string_view uniformName, const glm::mat4& value);
+
+	template <typename T, FixedString Name>
+	void setUniform(const Uniform<T, Name>& uniform, const std::type_identity_t<T>& value) {
+		setUniformSlot(uniform.slot(*this), value);
+	}
+
+	// The program's uniform blocks. Blocks named in SHARED_UNIFORM_BLOCKS (UniformBuffer.h) are
+	// bound to their shared binding point when the program is linked.
+	const std::vector<UniformBlockInfo>& uniformBlocks();
+	const UniformBlockInfo* uniformBlock(std::string_view blockName);
+
+	const UniformCacheStats& uniformStats() const;
+	void resetUniformStats();
+
+	const ShaderLoadReport& loadReport() const;
+};
+
+template <typename T, FixedString Name>
+Uniform<T, Name>::Uniform(ShaderProgram& program)
+	: m_slot(program.bindUniform(hash, type, name)), m_generation(program.m_generation) {
+}
 
-	void setUniform(const std::string& uniformName, bool value);
-	void setUniform(const std::string& uniformName, int32_t value);
-	void setUniform(const std::string& uniformName, float value);
-	void setUniform(const std::string& uniformName, const glm::vec2& value);
-	void setUniform(const std::string& uniformName, const glm::vec3& value);
-	void setUniform(const std::string& uniformName, const glm::vec4& value);
-	void setUniform(const std::string& uniformName, const glm::mat2& value);
-	void setUniform(const std::string& uniformName, const glm::mat3& value);
-	void setUniform(const std::string& uniformName, const glm::mat4& value);
-};
\ No newline at end of file
+template <typename T, FixedString Name>
+uint32_t Uniform<T, Name>::slot(ShaderProgram& program) const {
+	if (m_generation != program.m_generation) {
+		m_slot = program.bindUniform(hash, type, name);
+		m_generation = program.m_generation;
+	}
+	return m_slot;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "GlHandle.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderProgram.h"
+
+// Owns compiled shader objects and linked programs, so each is only built once. Shader objects are
+// keyed by stage, path and a hash of their preprocessed source (so each define permutation is its
+// own entry), and programs by the pair of shaders they link (or, for separable programs, the one
+// shader they contain). Asking for a program that already exists returns the same ShaderProgram.
+// Requests are also remembered by path and defines, so asking again skips reading and
+// preprocessing the sources; clear() forgets them, so edited files are picked up afterwards.
+class ShaderRegistry {
+	ShaderFileReader m_readFile;
+	std::unordered_map<uint64_t, GlShader> m_shaders;
+	std::unordered_map<uint64_t, std::unique_ptr<ShaderProgram>> m_programs;
+	// The key in m_programs each request was answered with.
+	std::unordered_map<uint64_t, uint64_t> m_requests;
+
+	uint32_t shader(ShaderStage stage, uint64_t key, const std::string& code);
+	ShaderProgram* requested(uint64_t request);
+
+public:
+	explicit ShaderRegistry(ShaderFileReader readFile = readShaderFile);
+	ShaderRegistry(const ShaderRegistry&) = delete;
+	ShaderRegistry& operator=(const ShaderRegistry&) = delete;
+
+	// Returns the program linking the two shaders, starting its compile and link if this is the
+	// first request for it. As with ShaderProgram::loadAsync, errors surface when the program is
+	// first used. The reference stays valid for the registry's lifetime.
+	ShaderProgram& program(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+		const ShaderDefines& defines = {});
+
+	// Returns the separable program for a single stage, for use in a ProgramPipeline. Each is built
+	// once, so N vertex and M fragment shaders take N + M links rather than N * M.
+	ShaderProgram& stage(ShaderStage stage, const std::string& shaderPath, const ShaderDefines& defines = {});
+
+	size_t shaderCount() const;
+	size_t programCount() const;
+
+	// Deletes every shader and program. References returned by program() become invalid.
+	void clear();
+};
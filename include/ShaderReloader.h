@@ -0,0 +1,91 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ShaderProgram.h"
+
+// Timings for ShaderReloader, in milliseconds.
+struct ShaderReloadStats {
+	uint64_t reloads;
+	uint64_t failures;
+	// From the shader file changing on disk to the new program being swapped in.
+	double lastLatency;
+	double maxLatency;
+	// Time spent inside update() on the most recent frame, and the worst frame so far.
+	double lastUpdateTime;
+	double maxUpdateTime;
+};
+
+// Watches the files of registered ShaderPrograms and recompiles a program when one of them
+// changes on disk. Files are watched and read on a background thread (with inotify on Linux, by
+// polling modification times elsewhere). The recompile is submitted without waiting on the driver,
+// and the new program only replaces the old one once it is ready, in update(). A program that fails
+// to compile is reported and discarded, and the old one keeps running.
+class ShaderReloader {
+	using Clock = std::chrono::steady_clock;
+
+	struct WatchedProgram {
+		ShaderProgram* program;
+		std::string vertexShaderPath;
+		std::string fragmentShaderPath;
+		ShaderDefines defines;
+		// Every file the program was built from, including #included ones.
+		std::vector<std::string> files;
+		// A replacement that has been submitted to the driver but not swapped in yet.
+		ShaderProgram candidate;
+		bool reloading;
+		Clock::time_point changedAt;
+	};
+
+	struct ChangedSource {
+		std::string code;
+		Clock::time_point changedAt;
+	};
+
+	std::vector<WatchedProgram> m_programs;
+	// Latest known contents of every watched file, keyed by normalized path. Only touched on the
+	// thread that calls watch() and update().
+	std::unordered_map<std::string, std::string> m_sources;
+	ShaderReloadStats m_stats;
+
+	// Shared with the watcher thread.
+	std::mutex m_mutex;
+	std::vector<std::string> m_watchedFiles;
+	std::unordered_map<std::string, ChangedSource> m_changed;
+#ifdef __linux__
+	int m_inotify;
+	// inotify watch descriptor -> the directory it watches.
+	std::unordered_map<int, std::filesystem::path> m_watchedDirectories;
+#endif
+
+	std::jthread m_watcher;
+
+	void watchFiles(std::stop_token stop);
+	void fileChanged(const std::string& path);
+	void addWatchedFile(const std::string& path);
+	std::optional<std::string> readSource(const std::string& path);
+	void startReload(WatchedProgram& watched);
+
+public:
+	ShaderReloader();
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+	~ShaderReloader();
+
+	// Reloads the given program whenever either file, or a file they include, changes. The program
+	// must outlive the reloader, or be passed to unwatch.
+	void watch(ShaderProgram& program, const std::string& vertexShaderPath,
+		const std::string& fragmentShaderPath, const ShaderDefines& defines = {});
+	void unwatch(const ShaderProgram& program);
+
+	// Call once per frame, at a point where no program is in use mid-draw. Starts recompiling
+	// programs whose files changed, and swaps in any recompiled program that has finished.
+	void update();
+
+	const ShaderReloadStats& stats() const;
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "ShaderProgram.h"
+
+// Lists the uniforms in the default block of a SPIR-V module that have an explicit (or
+// glslangValidator --aml assigned) location. The driver can't be asked about SPIR-V uniforms by
+// name, so ShaderProgram reads the names, locations and types from the module instead. Throws if
+// the module is malformed.
+std::vector<DeclaredUniform> reflectSpirvUniforms(std::span<const uint32_t> module);
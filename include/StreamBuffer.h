@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GlHandle.h"
+
+// glad's sync object type, declared here so this header doesn't need glad.
+struct __GLsync;
+
+// Counters describing how often a StreamBuffer had to wait for the GPU.
+struct StreamBufferStats {
+	uint64_t frames;
+	// Frames that found the GPU still reading the region they were about to reuse.
+	uint64_t fenceWaits;
+	double waitMilliseconds;
+	// The most bytes allocated in a single frame.
+	size_t peakFrameBytes;
+};
+
+// A range of a StreamBuffer, written through `data` and bound with bindRange.
+struct StreamAllocation {
+	std::byte* data;
+	size_t offset;
+	size_t size;
+};
+
+// A ring of per-frame regions in one GL buffer, for data that is rewritten every frame (uniform
+// blocks, per-draw transforms). Each frame allocates from its own region, and a fence placed at
+// endFrame keeps the CPU from reusing a region the GPU may still be reading, which also caps how
+// many frames the CPU can run ahead.
+//
+// With GL 4.4 or ARB_buffer_storage the whole ring is mapped once, persistently and coherently,
+// and allocations are written straight into it. Otherwise the frame's region is mapped
+// unsynchronized by its first allocation, which the fences make safe, and unmapped by flush, so a
+// frame costs one map rather than an upload per draw.
+class StreamBuffer {
+	uint32_t m_target;
+	size_t m_frameSize;
+	uint32_t m_framesInFlight;
+	size_t m_alignment;
+	GlBuffer m_buffer;
+	bool m_persistent;
+	// The persistent mapping of the whole ring, or the frame's region from m_mappedStart on while it
+	// is mapped without persistence; otherwise nullptr.
+	std::byte* m_mapped;
+	size_t m_mappedStart;
+
+	uint32_t m_frame;
+	size_t m_frameOffset;
+	std::vector<__GLsync*> m_fences;
+	StreamBufferStats m_stats;
+
+	size_t regionStart() const;
+	void waitForFence(uint32_t frame);
+
+public:
+	// target is the binding target the buffer is used through, e.g. GL_UNIFORM_BUFFER, which
+	// also decides the alignment of allocations.
+	StreamBuffer(uint32_t target, size_t frameSize, uint32_t framesInFlight = 3);
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+	~StreamBuffer();
+
+	static bool persistentMappingSupported();
+
+	// Moves on to the next region, waiting for the GPU to finish with it if necessary.
+	void beginFrame();
+	// Fences the frame's region. Call after the frame's last draw that reads from the buffer.
+	void endFrame();
+
+	// Throws if the frame's region is full.
+	StreamAllocation allocate(size_t size);
+	// Binds the allocation to an indexed binding point of the target.
+	void bindRange(uint32_t index, const StreamAllocation& allocation);
+	// Makes what was written to this frame's allocations visible to the GPU. Call before any draw
+	// that reads them; without persistent mapping, the buffer can't be drawn from until then.
+	void flush();
+
+	const StreamBufferStats& stats() const;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "GlHandle.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+// A uniform block that every program shares, bound to the same binding point in all of them.
+struct SharedUniformBlock {
+	std::string_view name;
+	uint32_t binding;
+};
+
+// The per-frame view and projection matrices, declared in shaders_source/camera.glsl.
+inline constexpr SharedUniformBlock CAMERA_BLOCK{ "Camera", 0 };
+// The per-draw model matrix, declared in shaders_source/object.glsl.
+inline constexpr SharedUniformBlock OBJECT_BLOCK{ "Object", 1 };
+
+// ShaderProgram binds any block with one of these names to its binding point after linking, since
+// GLSL 330 has no layout(binding) qualifier.
+inline constexpr std::array SHARED_UNIFORM_BLOCKS{ CAMERA_BLOCK, OBJECT_BLOCK };
+
+// The byte offset of each member of a uniform block under std140 rules, computed as members are
+// added in declaration order.
+class Std140Layout {
+public:
+	struct Member {
+		std::string name;
+		UniformType type;
+		uint32_t arraySize;
+		uint32_t offset;
+	};
+
+private:
+	std::vector<Member> m_members;
+	uint32_t m_size;
+
+public:
+	Std140Layout();
+
+	Std140Layout& add(std::string name, UniformType type, uint32_t arraySize = 1);
+
+	const Member* member(std::string_view name) const;
+	const std::vector<Member>& members() const;
+	// Size of the whole block, padded to a multiple of a vec4.
+	uint32_t size() const;
+};
+
+// A GL buffer holding one shared uniform block, bound to the block's binding point so every
+// program sees it. Values are written to a CPU copy in std140 layout, and upload() sends whatever
+// changed since the last call with a single glBufferSubData, however many programs use the block.
+class UniformBuffer {
+	SharedUniformBlock m_block;
+	Std140Layout m_layout;
+	std::vector<std::byte> m_data;
+	GlBuffer m_buffer;
+	// The bytes of m_data changed since the last upload; nothing when begin >= end.
+	size_t m_dirtyBegin;
+	size_t m_dirtyEnd;
+	// Whether the binding point was last pointed at a StreamBuffer range rather than m_buffer.
+	bool m_boundToStream;
+
+	void write(std::string_view memberName, UniformType type, const void* value, size_t size);
+
+public:
+	UniformBuffer(SharedUniformBlock block, Std140Layout layout);
+
+	template <typename T>
+	void set(std::string_view memberName, const T& value) {
+		if constexpr (std::is_same_v<T, bool>) {
+			// A GLSL bool takes four bytes in a block.
+			int32_t asInt{ value };
+			write(memberName, UniformType::Bool, &asInt, sizeof(asInt));
+		}
+		else {
+			write(memberName, UniformTypeOf<T>::value, &value, sizeof(T));
+		}
+	}
+
+	void upload();
+	// Copies the whole block into a fresh allocation from the stream buffer, and binds that to the
+	// block's binding point. For blocks rewritten per frame or per draw, where each draw must see
+	// the values set before it. Flush the stream before drawing.
+	void upload(StreamBuffer& stream);
+
+	// Throws if the program declares this block with a layout other than ours. Does nothing if the
+	// program doesn't use the block.
+	void verify(ShaderProgram& program) const;
+
+	const Std140Layout& layout() const;
+};
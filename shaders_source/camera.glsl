@@ -0,0 +1,10 @@
+// The per-frame camera matrices, shared by every program through a uniform buffer bound to
+// CAMERA_BLOCK's binding point (see UniformBuffer.h).
+#ifdef GL_SPIRV
+layout (std140, binding=0) uniform Camera {
+#else
+layout (std140) uniform Camera {
+#endif
+    mat4 view;
+    mat4 projection;
+};
@@ -1,8 +1,6 @@
 #version 330
-layout (location=0) in vec3 vPosition;
-layout (location=1) in vec3 vNormal;
-layout (location=2) in vec3 vTangent;
-layout (location=3) in vec2 vTexCoord;
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_attributes.glsl"
 
 out vec2 TexCoord;
 void main() {
@@ -0,0 +1,9 @@
+// Per-draw values, written for each draw into a stream buffer range bound to OBJECT_BLOCK's
+// binding point (see UniformBuffer.h).
+#ifdef GL_SPIRV
+layout (std140, binding=1) uniform Object {
+#else
+layout (std140) uniform Object {
+#endif
+    mat4 model;
+};
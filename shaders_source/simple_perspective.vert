@@ -1,11 +1,13 @@
 #version 330
-layout (location=0) in vec3 vPosition;
-
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_attributes.glsl"
+#include "camera.glsl"
+#include "object.glsl"
 
+// The model-space normal, for fragment shaders that light the mesh.
+out vec3 Normal;
 void main() {
     // Project the position to clip space.
     gl_Position = projection * view * model * vec4(vPosition, 1.0);
+    Normal = vertexNormal();
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+// Vertex attribute locations shared by every vertex shader.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+// The direction of increasing u, with the bitangent's handedness in w (MikkTSpace's convention):
+// bitangent = vTangent.w * cross(vertexNormal(), vTangent.xyz).
+layout (location=2) in vec4 vTangent;
+layout (location=3) in vec2 vTexCoord;
+
+// The vertex's normal. Meshes uploaded with octahedral normals (MeshQuantization.h) store only two
+// components, unpacked here when the shader is built with OCTAHEDRAL_NORMALS defined.
+vec3 vertexNormal() {
+#ifdef OCTAHEDRAL_NORMALS
+    vec3 n = vec3(vNormal.xy, 1.0 - abs(vNormal.x) - abs(vNormal.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(vNormal.yx)) * vec2(vNormal.x >= 0.0 ? 1.0 : -1.0, vNormal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+#else
+    return vNormal;
+#endif
+}
@@ -0,0 +1,176 @@
+#include "AssimpImport.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "Hash.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+uint64_t importProfileKey(const MeshImportProfile& profile) {
+	std::array<uint32_t, 10> fields{
+		profile.assimpFlags, profile.triangulate, profile.joinIdenticalVertices, profile.generateNormals,
+		static_cast<uint32_t>(profile.normalWeighting), profile.generateTangents, profile.optimize,
+		profile.optimizeOverdraw, profile.buildMeshlets, profile.buildLods
+	};
+	return fnv1a(std::string_view{ reinterpret_cast<const char*>(fields.data()), sizeof(fields) });
+}
+
+size_t triangleCount(const aiMesh* mesh, bool triangulate) {
+	if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+		return mesh->mNumFaces;
+	}
+	if (!(mesh->mPrimitiveTypes & (triangulate ? aiPrimitiveType_TRIANGLE | aiPrimitiveType_POLYGON : aiPrimitiveType_TRIANGLE))) {
+		return 0;
+	}
+	// Only meshes that SortByPType didn't split have to be counted face by face.
+	size_t triangles{ 0 };
+	for (size_t i{ 0 }; i < mesh->mNumFaces; ++i) {
+		size_t corners{ mesh->mFaces[i].mNumIndices };
+		if (corners == VERTICES_PER_FACE || (triangulate && corners > VERTICES_PER_FACE)) {
+			triangles += corners - 2;
+		}
+	}
+	return triangles;
+}
+
+void fromAssimpMesh(const aiMesh* mesh, bool triangulate, std::span<Vertex3D> vertices, std::span<uint32_t> faces,
+	std::span<glm::vec2> texCoords) {
+	for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
+		// Each "vertex" from Assimp has to be transformed into a Vertex3D in our application.
+		vertices[i] = Vertex3D{ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+	}
+	if (!texCoords.empty()) {
+		for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
+			texCoords[i] = mesh->HasTextureCoords(0)
+				? glm::vec2{ mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y } : glm::vec2{ 0 };
+		}
+	}
+
+	size_t index{ 0 };
+	for (size_t i{ 0 }; i < mesh->mNumFaces && index < faces.size(); ++i) {
+		const aiFace& face{ mesh->mFaces[i] };
+		if (face.mNumIndices < VERTICES_PER_FACE || (!triangulate && face.mNumIndices != VERTICES_PER_FACE)) {
+			continue;
+		}
+		// A triangle, or a fan of triangles around the polygon's first corner.
+		for (size_t corner{ 2 }; corner < face.mNumIndices; ++corner) {
+			faces[index++] = face.mIndices[0];
+			faces[index++] = face.mIndices[corner - 1];
+			faces[index++] = face.mIndices[corner];
+		}
+	}
+}
+
+void fromAssimpScene(const aiScene* scene, bool triangulate, MeshData& mesh, bool texCoords) {
+	// Lay the meshes out one after another, after whatever the lists already held, so each can be
+	// converted straight into its own range.
+	struct Part {
+		const aiMesh* mesh;
+		size_t firstVertex;
+		Submesh submesh;
+	};
+	std::vector<Part> parts{};
+	size_t vertexCount{ mesh.vertices.size() };
+	size_t indexCount{ mesh.faces.size() };
+	bool hasTexCoords{ !mesh.texCoords.empty() };
+	for (size_t i{ 0 }; i < scene->mNumMeshes; ++i) {
+		const aiMesh* part{ scene->mMeshes[i] };
+		size_t indices{ triangleCount(part, triangulate) * VERTICES_PER_FACE };
+		if (indices == 0) {
+			continue;
+		}
+		parts.push_back(Part{ part, vertexCount, Submesh{
+			static_cast<uint32_t>(indexCount), static_cast<uint32_t>(indices), static_cast<int32_t>(vertexCount) } });
+		vertexCount += part->mNumVertices;
+		indexCount += indices;
+		hasTexCoords = hasTexCoords || (texCoords && part->HasTextureCoords(0));
+	}
+	if (vertexCount > INT32_MAX || indexCount > UINT32_MAX) {
+		throw std::runtime_error("model is too large for 32-bit indices");
+	}
+
+	mesh.vertices.resize(vertexCount);
+	mesh.faces.resize(indexCount);
+	if (hasTexCoords) {
+		// Vertices already held without texture coordinates get zeros.
+		mesh.texCoords.resize(vertexCount, glm::vec2{ 0 });
+	}
+	parallelFor(parts.size(), [&](size_t i) {
+		const Part& part{ parts[i] };
+		std::span<glm::vec2> partTexCoords{};
+		if (hasTexCoords) {
+			partTexCoords = std::span{ mesh.texCoords }.subspan(part.firstVertex, part.mesh->mNumVertices);
+		}
+		fromAssimpMesh(part.mesh, triangulate,
+			std::span{ mesh.vertices }.subspan(part.firstVertex, part.mesh->mNumVertices),
+			std::span{ mesh.faces }.subspan(part.submesh.indexOffset, part.submesh.indexCount), partTexCoords);
+	});
+	for (const Part& part : parts) {
+		mesh.submeshes.push_back(part.submesh);
+	}
+}
+
+MeshImportReport importMesh(const std::string& path, const MeshImportProfile& profile, MeshData& mesh) {
+	MeshImportReport report{};
+	auto start{ Clock::now() };
+
+	Assimp::Importer importer{};
+	const aiScene* scene{ importer.ReadFile(path, profile.assimpFlags) };
+	if (nullptr == scene || scene->mNumMeshes == 0) {
+		throw std::runtime_error(scene ? path + " contains no meshes" : importer.GetErrorString());
+	}
+	report.read = millisecondsSince(start);
+
+	auto step{ Clock::now() };
+	fromAssimpScene(scene, profile.triangulate, mesh, profile.generateTangents);
+	report.convert = millisecondsSince(step);
+	// Everything needed has been copied out of the scene.
+	importer.FreeScene();
+
+	if (profile.joinIdenticalVertices) {
+		step = Clock::now();
+		joinIdenticalVertices(mesh);
+		report.joinVertices = millisecondsSince(step);
+	}
+	if (profile.generateNormals) {
+		step = Clock::now();
+		generateNormals(mesh, profile.normalWeighting);
+		report.generateNormals = millisecondsSince(step);
+	}
+	if (profile.generateTangents) {
+		step = Clock::now();
+		generateTangents(mesh);
+		report.generateTangents = millisecondsSince(step);
+	}
+	if (profile.optimize) {
+		step = Clock::now();
+		report.optimization = optimizeMesh(mesh, profile.optimizeOverdraw, profile.analyzeOptimization);
+		report.optimize = millisecondsSince(step);
+	}
+	if (profile.buildMeshlets) {
+		step = Clock::now();
+		buildMeshlets(mesh);
+		report.buildMeshlets = millisecondsSince(step);
+	}
+	if (profile.buildLods) {
+		step = Clock::now();
+		buildLods(mesh);
+		report.buildLods = millisecondsSince(step);
+	}
+	report.total = millisecondsSince(start);
+	return report;
+}
@@ -0,0 +1,219 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOUNDS_SSE2
+#endif
+
+namespace {
+	// Vertices reduced by one task.
+	const size_t BOUNDS_BLOCK_SIZE{ 64 * 1024 };
+
+	// Vertices [first, last) of one of the ranges being bounded.
+	struct VertexBlock {
+		size_t first;
+		size_t last;
+		size_t range;
+	};
+
+	// Inside out, so the first vertex enclosed sets both corners.
+	const BoundingBox EMPTY_BOX{ glm::vec3{ std::numeric_limits<float>::max() },
+		glm::vec3{ std::numeric_limits<float>::lowest() } };
+
+	glm::vec3 position(const Vertex3D& v) {
+		return glm::vec3{ v.x, v.y, v.z };
+	}
+
+#ifdef BOUNDS_SSE2
+	// Four vertices' positions, from three loads of their 48 bytes, turned into one register per
+	// axis.
+	void loadFour(const Vertex3D* vertices, __m128& x, __m128& y, __m128& z) {
+		const float* p{ &vertices->x };
+		__m128 a{ _mm_loadu_ps(p) };     // x0 y0 z0 x1
+		__m128 b{ _mm_loadu_ps(p + 4) }; // y1 z1 x2 y2
+		__m128 c{ _mm_loadu_ps(p + 8) }; // z2 x3 y3 z3
+		x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+			_MM_SHUFFLE(2, 0, 2, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+			_MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+			_MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	float horizontalMin(__m128 v) {
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+
+	float horizontalMax(__m128 v) {
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+
+	__m128 squaredDistance(__m128 x, __m128 y, __m128 z, const glm::vec3& center) {
+		__m128 dx{ _mm_sub_ps(x, _mm_set1_ps(center.x)) };
+		__m128 dy{ _mm_sub_ps(y, _mm_set1_ps(center.y)) };
+		__m128 dz{ _mm_sub_ps(z, _mm_set1_ps(center.z)) };
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+	}
+#endif
+
+	float squaredDistance(const Vertex3D& v, const glm::vec3& center) {
+		glm::vec3 d{ position(v) - center };
+		return glm::dot(d, d);
+	}
+
+	// The box around count vertices.
+	BoundingBox reduceBox(const Vertex3D* vertices, size_t count) {
+		BoundingBox box{ EMPTY_BOX };
+		size_t i{ 0 };
+#ifdef BOUNDS_SSE2
+		if (count >= 4) {
+			__m128 lowX{ _mm_set1_ps(box.low.x) };
+			__m128 lowY{ lowX };
+			__m128 lowZ{ lowX };
+			__m128 highX{ _mm_set1_ps(box.high.x) };
+			__m128 highY{ highX };
+			__m128 highZ{ highX };
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z;
+				loadFour(vertices + i, x, y, z);
+				lowX = _mm_min_ps(lowX, x);
+				lowY = _mm_min_ps(lowY, y);
+				lowZ = _mm_min_ps(lowZ, z);
+				highX = _mm_max_ps(highX, x);
+				highY = _mm_max_ps(highY, y);
+				highZ = _mm_max_ps(highZ, z);
+			}
+			box.low = glm::vec3{ horizontalMin(lowX), horizontalMin(lowY), horizontalMin(lowZ) };
+			box.high = glm::vec3{ horizontalMax(highX), horizontalMax(highY), horizontalMax(highZ) };
+		}
+#endif
+		for (; i < count; ++i) {
+			box.low = glm::min(box.low, position(vertices[i]));
+			box.high = glm::max(box.high, position(vertices[i]));
+		}
+		return box;
+	}
+
+	// The largest squared distances from count vertices to each of two centres.
+	glm::vec2 reduceDistances(const Vertex3D* vertices, size_t count, const glm::vec3& first,
+		const glm::vec3& second) {
+		glm::vec2 furthest{ 0 };
+		size_t i{ 0 };
+#ifdef BOUNDS_SSE2
+		if (count >= 4) {
+			__m128 toFirst{ _mm_setzero_ps() };
+			__m128 toSecond{ _mm_setzero_ps() };
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z;
+				loadFour(vertices + i, x, y, z);
+				toFirst = _mm_max_ps(toFirst, squaredDistance(x, y, z, first));
+				toSecond = _mm_max_ps(toSecond, squaredDistance(x, y, z, second));
+			}
+			furthest = glm::vec2{ horizontalMax(toFirst), horizontalMax(toSecond) };
+		}
+#endif
+		for (; i < count; ++i) {
+			furthest.x = std::max(furthest.x, squaredDistance(vertices[i], first));
+			furthest.y = std::max(furthest.y, squaredDistance(vertices[i], second));
+		}
+		return furthest;
+	}
+
+	// Splits each range into blocks of up to BOUNDS_BLOCK_SIZE vertices.
+	std::vector<VertexBlock> vertexBlocks(const std::vector<std::pair<size_t, size_t>>& ranges) {
+		std::vector<VertexBlock> blocks{};
+		for (size_t r{ 0 }; r < ranges.size(); ++r) {
+			for (size_t first{ ranges[r].first }; first < ranges[r].second; first += BOUNDS_BLOCK_SIZE) {
+				blocks.push_back(VertexBlock{ first, std::min(first + BOUNDS_BLOCK_SIZE, ranges[r].second), r });
+			}
+		}
+		return blocks;
+	}
+
+	// Each range's box, from its blocks' boxes, reduced in parallel. Empty ranges stay EMPTY_BOX.
+	std::vector<BoundingBox> rangeBoxes(std::span<const Vertex3D> vertices, const std::vector<VertexBlock>& blocks,
+		size_t rangeCount) {
+		std::vector<BoundingBox> blockBoxes(blocks.size());
+		parallelFor(blocks.size(), [&](size_t b) {
+			blockBoxes[b] = reduceBox(vertices.data() + blocks[b].first, blocks[b].last - blocks[b].first);
+		});
+		std::vector<BoundingBox> boxes(rangeCount, EMPTY_BOX);
+		for (size_t b{ 0 }; b < blocks.size(); ++b) {
+			boxes[blocks[b].range] = enclose(boxes[blocks[b].range], blockBoxes[b]);
+		}
+		return boxes;
+	}
+
+	// The box, or an empty one at the origin if nothing was enclosed.
+	BoundingBox settled(const BoundingBox& box) {
+		return box.low.x > box.high.x ? BoundingBox{ glm::vec3{ 0 }, glm::vec3{ 0 } } : box;
+	}
+}
+
+MeshBounds meshBounds(std::span<const Vertex3D> vertices, std::span<const Submesh> submeshes) {
+	// Each submesh's vertices, or all of them if there are no submeshes.
+	std::vector<std::pair<size_t, size_t>> ranges{};
+	std::vector<int32_t> starts(submeshes.size());
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		starts[i] = submeshes[i].baseVertex;
+	}
+	std::sort(starts.begin(), starts.end());
+	for (const Submesh& submesh : submeshes) {
+		auto next{ std::upper_bound(starts.begin(), starts.end(), submesh.baseVertex) };
+		size_t end{ next == starts.end() ? vertices.size() : static_cast<size_t>(*next) };
+		ranges.emplace_back(std::min(static_cast<size_t>(submesh.baseVertex), end), end);
+	}
+	if (submeshes.empty()) {
+		ranges.emplace_back(0, vertices.size());
+	}
+	std::vector<VertexBlock> blocks{ vertexBlocks(ranges) };
+
+	std::vector<BoundingBox> boxes{ rangeBoxes(vertices, blocks, ranges.size()) };
+	BoundingBox meshBox{ EMPTY_BOX };
+	for (BoundingBox& box : boxes) {
+		meshBox = enclose(meshBox, box);
+		box = settled(box);
+	}
+	meshBox = settled(meshBox);
+	glm::vec3 meshCenter{ (meshBox.low + meshBox.high) * 0.5f };
+
+	std::vector<glm::vec2> blockDistances(blocks.size());
+	parallelFor(blocks.size(), [&](size_t b) {
+		const BoundingBox& box{ boxes[blocks[b].range] };
+		blockDistances[b] = reduceDistances(vertices.data() + blocks[b].first, blocks[b].last - blocks[b].first,
+			(box.low + box.high) * 0.5f, meshCenter);
+	});
+	std::vector<float> furthest(ranges.size(), 0);
+	float meshFurthest{ 0 };
+	for (size_t b{ 0 }; b < blocks.size(); ++b) {
+		furthest[blocks[b].range] = std::max(furthest[blocks[b].range], blockDistances[b].x);
+		meshFurthest = std::max(meshFurthest, blockDistances[b].y);
+	}
+
+	MeshBounds bounds{ BoundingVolumes{ meshBox, BoundingSphere{ meshCenter, std::sqrt(meshFurthest) } }, {} };
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		glm::vec3 center{ (boxes[i].low + boxes[i].high) * 0.5f };
+		bounds.submeshes.push_back(BoundingVolumes{ boxes[i], BoundingSphere{ center, std::sqrt(furthest[i]) } });
+	}
+	return bounds;
+}
+
+BoundingBox boundingBox(std::span<const Vertex3D> vertices) {
+	return settled(rangeBoxes(vertices, vertexBlocks({ { 0, vertices.size() } }), 1)[0]);
+}
+
+BoundingBox enclose(const BoundingBox& a, const BoundingBox& b) {
+	return BoundingBox{ glm::min(a.low, b.low), glm::max(a.high, b.high) };
+}
+
+BoundingSphere boundingSphere(std::span<const Vertex3D> vertices) {
+	return meshBounds(vertices, {}).mesh.sphere;
+}
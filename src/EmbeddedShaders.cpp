@@ -0,0 +1,17 @@
+#include "EmbeddedShaders.h"
+#include "EmbeddedShaderTable.h"
+#include "ShaderPreprocessor.h"
+
+std::optional<std::string> readEmbeddedShader(const std::string& name) {
+#ifdef SHADER_DISK_OVERRIDE
+	if (auto code{ readShaderFile("shaders/" + name) }) {
+		return code;
+	}
+#endif
+	for (const EmbeddedShader& shader : EMBEDDED_SHADER_TABLE) {
+		if (shader.name == name) {
+			return std::string{ shader.source };
+		}
+	}
+	return std::nullopt;
+}
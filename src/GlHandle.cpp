@@ -0,0 +1,24 @@
+#include "GlHandle.h"
+#include <glad/glad.h>
+
+void deleteGlObject(GlObjectType type, uint32_t id) {
+	switch (type) {
+	case GlObjectType::Shader:
+		glDeleteShader(id);
+		break;
+	case GlObjectType::Program:
+		glDeleteProgram(id);
+		break;
+	case GlObjectType::Buffer:
+		glDeleteBuffers(1, &id);
+		break;
+	case GlObjectType::VertexArray:
+		glDeleteVertexArrays(1, &id);
+		break;
+	case GlObjectType::ProgramPipeline:
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		glDeleteProgramPipelines(1, &id);
+#endif
+		break;
+	}
+}
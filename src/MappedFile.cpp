@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+	: m_data(nullptr), m_size(0)
+#ifdef _WIN32
+	, m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif
+{
+#ifdef _WIN32
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open " + path);
+	}
+	LARGE_INTEGER size{};
+	GetFileSizeEx(m_file, &size);
+	m_size = static_cast<size_t>(size.QuadPart);
+	if (m_size > 0) {
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* view{ m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr };
+		if (!view) {
+			close();
+			throw std::runtime_error("Failed to map " + path);
+		}
+		m_data = static_cast<const std::byte*>(view);
+	}
+#else
+	int file{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (file < 0) {
+		throw std::runtime_error("Failed to open " + path);
+	}
+	struct stat status {};
+	if (fstat(file, &status) != 0) {
+		::close(file);
+		throw std::runtime_error("Failed to open " + path);
+	}
+	m_size = static_cast<size_t>(status.st_size);
+	if (m_size > 0) {
+		void* view{ mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0) };
+		if (view == MAP_FAILED) {
+			::close(file);
+			throw std::runtime_error("Failed to map " + path);
+		}
+		// Files are mostly read front to back.
+		madvise(view, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const std::byte*>(view);
+	}
+	// The mapping keeps the file's contents alive on its own.
+	::close(file);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+#ifdef _WIN32
+	, m_file(std::exchange(other.m_file, INVALID_HANDLE_VALUE)), m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+		m_file = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+		m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+#else
+	if (m_data) {
+		munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+std::span<const std::byte> MappedFile::bytes() const {
+	return { m_data, m_size };
+}
+
+std::string_view MappedFile::text() const {
+	return { reinterpret_cast<const char*>(m_data), m_size };
+}
+
+size_t MappedFile::size() const {
+	return m_size;
+}
+
+void MappedFile::release(std::span<const std::byte> range) const {
+	if (range.empty()) {
+		return;
+	}
+#ifdef _WIN32
+	// Unlocking pages that aren't locked takes them out of the working set.
+	VirtualUnlock(const_cast<std::byte*>(range.data()), range.size());
+#else
+	uintptr_t page{ static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) };
+	uintptr_t begin{ (reinterpret_cast<uintptr_t>(range.data()) + page - 1) / page * page };
+	uintptr_t end{ (reinterpret_cast<uintptr_t>(range.data()) + range.size()) / page * page };
+	if (end > begin) {
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+	}
+#endif
+}
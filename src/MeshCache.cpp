@@ -0,0 +1,283 @@
+#include "MeshCache.h"
+#include "Bounds.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+	// Relative to the working directory, like shadercache.
+	const std::filesystem::path MESH_CACHE_DIRECTORY{ "meshcache" };
+	const uint32_t MESH_CACHE_MAGIC{ 0x48534D43 }; // "CMSH"
+	// Bump whenever the layout of cooked meshes, or of Vertex3D, or the meaning of what they store
+	// changes.
+	const uint32_t MESH_CACHE_VERSION{ 9 };
+
+	// Precedes the vertex stream, which is followed by the index stream, the submesh table, the
+	// error of each level of detail, each level's submesh table, the meshlet table, the bounds of
+	// each submesh, and then whichever of the normal, tangent and texture coordinate streams the
+	// attributes flags say there are, vertexCount entries each. Padded to 16 bytes so the streams
+	// stay aligned in the mapping. The bounds and largest index are stored so the streams can be
+	// uploaded a piece at a time, without a pass over them first, and the source's size and time so
+	// a warm load needn't read the source.
+	struct CookedMeshHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t vertexSize;
+		uint32_t lodCount;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t submeshCount;
+		uint64_t meshletCount;
+		uint32_t maxIndex;
+		BoundingVolumes bounds;
+		uint32_t attributes;
+		MeshSource source;
+	};
+	static_assert(sizeof(CookedMeshHeader) % 16 == 0);
+
+	// Flags for CookedMeshHeader::attributes.
+	const uint32_t COOKED_NORMALS{ 1 };
+	const uint32_t COOKED_TANGENTS{ 2 };
+	const uint32_t COOKED_TEX_COORDS{ 4 };
+
+	// The file's modification time, as recorded in MeshSource; 0 if it can't be read.
+	int64_t modifiedTime(const std::string& path) {
+		std::error_code error;
+		auto time{ std::filesystem::last_write_time(path, error) };
+		return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+	}
+
+	std::filesystem::path meshCachePath(uint64_t key) {
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".mesh";
+		return MESH_CACHE_DIRECTORY / name.str();
+	}
+}
+
+uint64_t meshCacheKey(const std::string& path, uint64_t importKey) {
+	uint64_t key{ fnv1a(path) };
+	key = fnv1a(std::string_view{ "\0", 1 }, key);
+	return fnv1a(std::string_view{ reinterpret_cast<const char*>(&importKey), sizeof(importKey) }, key);
+}
+
+MeshSource meshSource(const std::string& path) {
+	MappedFile file{ path };
+	return MeshSource{ file.size(), modifiedTime(path), hashContents(file.bytes()) };
+}
+
+CookedMesh::CookedMesh(MappedFile file, uint64_t key, const MeshSource& source, std::span<const Vertex3D> vertices,
+	std::span<const uint32_t> indices, std::span<const Submesh> submeshes, std::span<const float> lodErrors,
+	std::span<const Submesh> lodSubmeshes, std::span<const Meshlet> meshlets,
+	std::span<const BoundingVolumes> submeshBounds, const VertexAttributes& attributes, uint32_t maxIndex,
+	const BoundingVolumes& bounds)
+	: m_file(std::move(file)), m_key(key), m_source(source), m_vertices(vertices), m_indices(indices), m_submeshes(submeshes),
+	m_lodErrors(lodErrors), m_lodSubmeshes(lodSubmeshes), m_meshlets(meshlets), m_submeshBounds(submeshBounds),
+	m_normals(attributes.normals), m_tangents(attributes.tangents), m_texCoords(attributes.texCoords),
+	m_maxIndex(maxIndex), m_bounds(bounds) {
+}
+
+std::optional<CookedMesh> CookedMesh::open(uint64_t key, const std::string& sourcePath) {
+	std::string path{ meshCachePath(key).string() };
+	std::optional<CookedMesh> mesh{ openFile(path) };
+	if (!mesh || mesh->key() != key || !mesh->cookedFrom(sourcePath)) {
+		return std::nullopt;
+	}
+	int64_t modified{ modifiedTime(sourcePath) };
+	if (modified != mesh->m_source.modified) {
+		// Touched but not changed. Record the new time, so the contents aren't hashed again next
+		// time; if that fails, they just are. Windows doesn't let a mapped file be opened for
+		// writing, so the mapping is dropped first, and the file mapped again once it's written.
+		mesh.reset();
+		{
+			std::fstream file{ path, std::ios::binary | std::ios::in | std::ios::out };
+			file.seekp(offsetof(CookedMeshHeader, source) + offsetof(MeshSource, modified));
+			file.write(reinterpret_cast<const char*>(&modified), sizeof(modified));
+		}
+		mesh = openFile(path);
+		if (!mesh || mesh->key() != key) {
+			return std::nullopt;
+		}
+	}
+	return mesh;
+}
+
+void CookedMesh::store(uint64_t key, const MeshSource& source, std::span<const Vertex3D> vertices,
+	std::span<const uint32_t> indices, std::span<const Submesh> submeshes, std::span<const MeshLod> lods,
+	std::span<const Meshlet> meshlets, const VertexAttributes& attributes) {
+	std::error_code error;
+	std::filesystem::create_directories(MESH_CACHE_DIRECTORY, error);
+	write(meshCachePath(key).string(), key, source, vertices, indices, submeshes, lods, meshlets, attributes);
+}
+
+std::optional<CookedMesh> CookedMesh::openFile(const std::string& path) {
+	std::error_code error;
+	if (!std::filesystem::exists(path, error)) {
+		return std::nullopt;
+	}
+	try {
+		MappedFile file{ path };
+		if (file.size() < sizeof(CookedMeshHeader)) {
+			return std::nullopt;
+		}
+		const auto* header{ reinterpret_cast<const CookedMeshHeader*>(file.bytes().data()) };
+		size_t vertexBytes{ header->vertexCount * sizeof(Vertex3D) };
+		size_t indexBytes{ header->indexCount * sizeof(uint32_t) };
+		size_t submeshBytes{ header->submeshCount * sizeof(Submesh) };
+		size_t lodErrorBytes{ header->lodCount * sizeof(float) };
+		size_t lodSubmeshBytes{ header->lodCount * submeshBytes };
+		size_t meshletBytes{ header->meshletCount * sizeof(Meshlet) };
+		size_t submeshBoundsBytes{ header->submeshCount * sizeof(BoundingVolumes) };
+		size_t normalCount{ header->attributes & COOKED_NORMALS ? header->vertexCount : 0 };
+		size_t tangentCount{ header->attributes & COOKED_TANGENTS ? header->vertexCount : 0 };
+		size_t texCoordCount{ header->attributes & COOKED_TEX_COORDS ? header->vertexCount : 0 };
+		size_t attributeBytes{
+			normalCount * sizeof(glm::vec3) + tangentCount * sizeof(glm::vec4) + texCoordCount * sizeof(glm::vec2) };
+		if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION
+			|| header->vertexSize != sizeof(Vertex3D)
+			|| file.size() != sizeof(CookedMeshHeader) + vertexBytes + indexBytes + submeshBytes + lodErrorBytes
+				+ lodSubmeshBytes + meshletBytes + submeshBoundsBytes + attributeBytes) {
+			// Stale or partly written; it will be replaced once the mesh has been cooked again.
+			return std::nullopt;
+		}
+		uint64_t key{ header->key };
+		const std::byte* data{ file.bytes().data() + sizeof(CookedMeshHeader) };
+		std::span<const Vertex3D> vertices{ reinterpret_cast<const Vertex3D*>(data), header->vertexCount };
+		std::span<const uint32_t> indices{ reinterpret_cast<const uint32_t*>(data + vertexBytes), header->indexCount };
+		data += vertexBytes + indexBytes;
+		std::span<const Submesh> submeshes{ reinterpret_cast<const Submesh*>(data), header->submeshCount };
+		data += submeshBytes;
+		std::span<const float> lodErrors{ reinterpret_cast<const float*>(data), header->lodCount };
+		data += lodErrorBytes;
+		std::span<const Submesh> lodSubmeshes{
+			reinterpret_cast<const Submesh*>(data), header->lodCount * header->submeshCount };
+		data += lodSubmeshBytes;
+		std::span<const Meshlet> meshlets{ reinterpret_cast<const Meshlet*>(data), header->meshletCount };
+		data += meshletBytes;
+		std::span<const BoundingVolumes> submeshBounds{
+			reinterpret_cast<const BoundingVolumes*>(data), header->submeshCount };
+		data += submeshBoundsBytes;
+		VertexAttributes attributes{};
+		attributes.normals = { reinterpret_cast<const glm::vec3*>(data), normalCount };
+		data += normalCount * sizeof(glm::vec3);
+		attributes.tangents = { reinterpret_cast<const glm::vec4*>(data), tangentCount };
+		data += tangentCount * sizeof(glm::vec4);
+		attributes.texCoords = { reinterpret_cast<const glm::vec2*>(data), texCoordCount };
+		return CookedMesh{ std::move(file), key, header->source, vertices, indices, submeshes, lodErrors, lodSubmeshes,
+			meshlets, submeshBounds, attributes, header->maxIndex, header->bounds };
+	}
+	catch (std::runtime_error&) {
+		return std::nullopt;
+	}
+}
+
+bool CookedMesh::write(const std::string& path, uint64_t key, const MeshSource& source,
+	std::span<const Vertex3D> vertices, std::span<const uint32_t> indices, std::span<const Submesh> submeshes,
+	std::span<const MeshLod> lods, std::span<const Meshlet> meshlets, const VertexAttributes& attributes) {
+	uint32_t attributeFlags{ 0 };
+	for (auto [count, flag] : { std::pair{ attributes.normals.size(), COOKED_NORMALS },
+		std::pair{ attributes.tangents.size(), COOKED_TANGENTS }, std::pair{ attributes.texCoords.size(), COOKED_TEX_COORDS } }) {
+		if (count != 0 && count != vertices.size()) {
+			return false;
+		}
+		attributeFlags |= count != 0 ? flag : 0;
+	}
+	MeshBounds bounds{ meshBounds(vertices, submeshes) };
+	uint32_t maxIndex{ indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) };
+	CookedMeshHeader header{
+		MESH_CACHE_MAGIC, MESH_CACHE_VERSION, key, sizeof(Vertex3D), static_cast<uint32_t>(lods.size()), vertices.size(),
+		indices.size(), submeshes.size(), meshlets.size(), maxIndex, bounds.mesh, attributeFlags, source
+	};
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size_bytes());
+	file.write(reinterpret_cast<const char*>(indices.data()), indices.size_bytes());
+	file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size_bytes());
+	for (const MeshLod& lod : lods) {
+		file.write(reinterpret_cast<const char*>(&lod.error), sizeof(lod.error));
+	}
+	for (const MeshLod& lod : lods) {
+		if (lod.submeshes.size() != submeshes.size()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(lod.submeshes.data()), std::span{ lod.submeshes }.size_bytes());
+	}
+	file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size_bytes());
+	file.write(reinterpret_cast<const char*>(bounds.submeshes.data()), std::span{ bounds.submeshes }.size_bytes());
+	file.write(reinterpret_cast<const char*>(attributes.normals.data()), attributes.normals.size_bytes());
+	file.write(reinterpret_cast<const char*>(attributes.tangents.data()), attributes.tangents.size_bytes());
+	file.write(reinterpret_cast<const char*>(attributes.texCoords.data()), attributes.texCoords.size_bytes());
+	return static_cast<bool>(file);
+}
+
+uint64_t CookedMesh::key() const {
+	return m_key;
+}
+
+bool CookedMesh::cookedFrom(const std::string& sourcePath) const {
+	std::error_code error;
+	uint64_t size{ std::filesystem::file_size(sourcePath, error) };
+	if (error || size != m_source.size) {
+		return false;
+	}
+	if (modifiedTime(sourcePath) == m_source.modified) {
+		return true;
+	}
+	try {
+		return meshSource(sourcePath).contentHash == m_source.contentHash;
+	}
+	catch (std::runtime_error&) {
+		return false;
+	}
+}
+
+std::span<const Vertex3D> CookedMesh::vertices() const {
+	return m_vertices;
+}
+
+std::span<const uint32_t> CookedMesh::indices() const {
+	return m_indices;
+}
+
+std::span<const Submesh> CookedMesh::submeshes() const {
+	return m_submeshes;
+}
+
+std::vector<MeshLod> CookedMesh::lods() const {
+	std::vector<MeshLod> lods{};
+	for (size_t i{ 0 }; i < m_lodErrors.size(); ++i) {
+		std::span<const Submesh> submeshes{ m_lodSubmeshes.subspan(i * m_submeshes.size(), m_submeshes.size()) };
+		lods.push_back(MeshLod{ { submeshes.begin(), submeshes.end() }, m_lodErrors[i] });
+	}
+	return lods;
+}
+
+std::span<const Meshlet> CookedMesh::meshlets() const {
+	return m_meshlets;
+}
+
+VertexAttributes CookedMesh::attributes() const {
+	return VertexAttributes{ m_normals, m_tangents, m_texCoords };
+}
+
+uint32_t CookedMesh::maxIndex() const {
+	return m_maxIndex;
+}
+
+BoundingVolumes CookedMesh::bounds() const {
+	return m_bounds;
+}
+
+std::span<const BoundingVolumes> CookedMesh::submeshBounds() const {
+	return m_submeshBounds;
+}
+
+void CookedMesh::release(std::span<const std::byte> range) const {
+	m_file.release(range);
+}
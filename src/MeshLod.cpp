@@ -0,0 +1,364 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "MeshOptimizer.h"
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+namespace {
+	// A level that keeps more than this share of the triangles of the one before it ends the chain.
+	const float LOD_MIN_REDUCTION{ 0.9f };
+
+	// A plane through a full-detail triangle, with a unit normal: ax + by + cz + d = 0.
+	struct Plane {
+		double a, b, c, d;
+
+		double distance(const Vertex3D& v) const {
+			return std::abs(a * v.x + b * v.y + c * v.z + d);
+		}
+	};
+
+	// A weighted sum of squared distances to a set of planes, as the upper triangle of a symmetric
+	// 4x4 matrix. Doubles, since the terms of large meshes cancel badly in float.
+	struct Quadric {
+		double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+
+		void addPlane(const Plane& p, double w) {
+			xx += w * p.a * p.a; xy += w * p.a * p.b; xz += w * p.a * p.c; xw += w * p.a * p.d;
+			yy += w * p.b * p.b; yz += w * p.b * p.c; yw += w * p.b * p.d;
+			zz += w * p.c * p.c; zw += w * p.c * p.d;
+			ww += w * p.d * p.d;
+		}
+
+		Quadric operator+(const Quadric& o) const {
+			return Quadric{ xx + o.xx, xy + o.xy, xz + o.xz, xw + o.xw, yy + o.yy, yz + o.yz, yw + o.yw,
+				zz + o.zz, zw + o.zw, ww + o.ww };
+		}
+
+		double error(const Vertex3D& v) const {
+			double x{ v.x };
+			double y{ v.y };
+			double z{ v.z };
+			return xx * x * x + yy * y * y + zz * z * z + ww
+				+ 2 * (xy * x * y + xz * x * z + yz * y * z + xw * x + yw * y + zw * z);
+		}
+	};
+
+	struct Edge {
+		// The collapsed vertex's weighted squared distance to the planes of both vertices'
+		// triangles.
+		double cost;
+		// Collapse from onto to; to keeps its position.
+		uint32_t from;
+		uint32_t to;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	glm::vec3 position(const Vertex3D& v) {
+		return glm::vec3{ v.x, v.y, v.z };
+	}
+
+	// Simplifies one index list into ever coarser ones. Quadrics are built from the full-detail
+	// triangles and carried from one call to the next, so every level's error is measured against
+	// the original surface.
+	class QuadricSimplifier {
+		std::span<const Vertex3D> m_vertices;
+		std::vector<Quadric> m_quadrics;
+		std::vector<bool> m_locked;
+		// The plane of every full-detail triangle (unused for ones without area), and for each
+		// vertex, the triangles whose planes its quadric sums. A collapse hands the collapsed
+		// vertex's triangles to the vertex it collapsed onto.
+		std::vector<Plane> m_planes;
+		std::vector<std::vector<uint32_t>> m_planesOf;
+		// The furthest any vertex a collapse kept is from the plane of a triangle it took on.
+		double m_maxError;
+
+		// Whether moving from onto to would turn any of from's other triangles over.
+		bool flips(std::span<const uint32_t> faces, std::span<const uint32_t> triangles, uint32_t from, uint32_t to) const {
+			glm::vec3 target{ position(m_vertices[to]) };
+			for (uint32_t triangle : triangles) {
+				const uint32_t* corners{ &faces[triangle * 3] };
+				if (corners[0] == to || corners[1] == to || corners[2] == to) {
+					continue;
+				}
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (size_t k{ 0 }; k < 3; ++k) {
+					before[k] = position(m_vertices[corners[k]]);
+					after[k] = corners[k] == from ? target : before[k];
+				}
+				glm::vec3 normalBefore{ glm::cross(before[1] - before[0], before[2] - before[0]) };
+				glm::vec3 normalAfter{ glm::cross(after[1] - after[0], after[2] - after[0]) };
+				if (glm::dot(normalBefore, normalAfter) <= 0) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+	public:
+		QuadricSimplifier(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces)
+			: m_vertices(vertices), m_quadrics(vertices.size(), Quadric{}), m_locked(vertices.size(), false),
+			m_planes(faces.size() / 3, Plane{}), m_planesOf(vertices.size()), m_maxError(0) {
+			std::vector<uint64_t> edges{};
+			edges.reserve(faces.size());
+			for (size_t i{ 0 }; i + 2 < faces.size(); i += 3) {
+				const Vertex3D& a{ vertices[faces[i]] };
+				const Vertex3D& b{ vertices[faces[i + 1]] };
+				const Vertex3D& c{ vertices[faces[i + 2]] };
+				double ux{ double{ b.x } - a.x }, uy{ double{ b.y } - a.y }, uz{ double{ b.z } - a.z };
+				double vx{ double{ c.x } - a.x }, vy{ double{ c.y } - a.y }, vz{ double{ c.z } - a.z };
+				double nx{ uy * vz - uz * vy };
+				double ny{ uz * vx - ux * vz };
+				double nz{ ux * vy - uy * vx };
+				double length{ std::sqrt(nx * nx + ny * ny + nz * nz) };
+				if (length > 0) {
+					nx /= length;
+					ny /= length;
+					nz /= length;
+					Plane& plane{ m_planes[i / 3] };
+					plane = Plane{ nx, ny, nz, -(nx * a.x + ny * a.y + nz * a.z) };
+					// Weighted by area, so slivers count for little.
+					for (size_t k{ 0 }; k < 3; ++k) {
+						m_quadrics[faces[i + k]].addPlane(plane, length * 0.5);
+						m_planesOf[faces[i + k]].push_back(static_cast<uint32_t>(i / 3));
+					}
+				}
+				for (size_t k{ 0 }; k < 3; ++k) {
+					edges.push_back(edgeKey(faces[i + k], faces[i + (k + 1) % 3]));
+				}
+			}
+
+			// An edge no triangle crosses in the other direction is on a border.
+			std::sort(edges.begin(), edges.end());
+			for (uint64_t edge : edges) {
+				uint32_t a{ static_cast<uint32_t>(edge >> 32) };
+				uint32_t b{ static_cast<uint32_t>(edge) };
+				if (!std::binary_search(edges.begin(), edges.end(), edgeKey(b, a))) {
+					m_locked[a] = true;
+					m_locked[b] = true;
+				}
+			}
+		}
+
+		std::vector<uint32_t> simplify(std::vector<uint32_t> faces, size_t targetIndexCount) {
+			const double LOCKED{ std::numeric_limits<double>::infinity() };
+			size_t vertexCount{ m_vertices.size() };
+			std::vector<uint32_t> remap(vertexCount);
+			std::vector<bool> touched(vertexCount);
+
+			// Each pass collapses the cheapest edges that don't share a neighbourhood, then rebuilds
+			// the index list.
+			while (faces.size() > targetIndexCount) {
+				std::vector<uint64_t> keys{};
+				keys.reserve(faces.size());
+				for (size_t i{ 0 }; i < faces.size(); i += 3) {
+					for (size_t k{ 0 }; k < 3; ++k) {
+						uint32_t a{ faces[i + k] };
+						uint32_t b{ faces[i + (k + 1) % 3] };
+						keys.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+					}
+				}
+				std::sort(keys.begin(), keys.end());
+				keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+				std::vector<Edge> edges{};
+				edges.reserve(keys.size());
+				for (uint64_t key : keys) {
+					uint32_t a{ static_cast<uint32_t>(key >> 32) };
+					uint32_t b{ static_cast<uint32_t>(key) };
+					Quadric sum{ m_quadrics[a] + m_quadrics[b] };
+					double aOntoB{ m_locked[a] ? LOCKED : sum.error(m_vertices[b]) };
+					double bOntoA{ m_locked[b] ? LOCKED : sum.error(m_vertices[a]) };
+					if (aOntoB == LOCKED && bOntoA == LOCKED) {
+						continue;
+					}
+					double cost{ std::max(std::min(aOntoB, bOntoA), 0.0) };
+					edges.push_back(aOntoB <= bOntoA ? Edge{ cost, a, b } : Edge{ cost, b, a });
+				}
+				std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+					return a.cost < b.cost;
+				});
+
+				// The triangles around each vertex, as ranges of one array.
+				std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+				for (uint32_t index : faces) {
+					++firstTriangle[index + 1];
+				}
+				for (size_t v{ 0 }; v < vertexCount; ++v) {
+					firstTriangle[v + 1] += firstTriangle[v];
+				}
+				std::vector<uint32_t> adjacency(faces.size());
+				std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+				for (size_t i{ 0 }; i < faces.size(); ++i) {
+					adjacency[filled[faces[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+
+				for (size_t v{ 0 }; v < vertexCount; ++v) {
+					remap[v] = static_cast<uint32_t>(v);
+				}
+				std::fill(touched.begin(), touched.end(), false);
+				size_t removable{ (faces.size() - targetIndexCount) / 3 };
+				size_t removed{ 0 };
+				bool collapsed{ false };
+				for (const Edge& edge : edges) {
+					if (removed >= removable) {
+						break;
+					}
+					if (touched[edge.from] || touched[edge.to]) {
+						continue;
+					}
+					std::span<const uint32_t> triangles{
+						adjacency.data() + firstTriangle[edge.from], firstTriangle[edge.from + 1] - firstTriangle[edge.from] };
+					if (flips(faces, triangles, edge.from, edge.to)) {
+						continue;
+					}
+					// Nothing around the collapse may move again this pass, or the flip test above
+					// would be out of date.
+					for (uint32_t triangle : triangles) {
+						const uint32_t* corners{ &faces[triangle * 3] };
+						if (corners[0] == edge.to || corners[1] == edge.to || corners[2] == edge.to) {
+							++removed;
+						}
+						touched[corners[0]] = true;
+						touched[corners[1]] = true;
+						touched[corners[2]] = true;
+					}
+					remap[edge.from] = edge.to;
+					m_quadrics[edge.to] = m_quadrics[edge.to] + m_quadrics[edge.from];
+					// to doesn't move, so it only has to be measured against the planes it takes on.
+					std::vector<uint32_t>& taken{ m_planesOf[edge.from] };
+					for (uint32_t plane : taken) {
+						m_maxError = std::max(m_maxError, m_planes[plane].distance(m_vertices[edge.to]));
+					}
+					std::vector<uint32_t>& planes{ m_planesOf[edge.to] };
+					planes.insert(planes.end(), taken.begin(), taken.end());
+					taken = {};
+					collapsed = true;
+				}
+				if (!collapsed) {
+					break;
+				}
+
+				size_t kept{ 0 };
+				for (size_t i{ 0 }; i < faces.size(); i += 3) {
+					uint32_t a{ remap[faces[i]] };
+					uint32_t b{ remap[faces[i + 1]] };
+					uint32_t c{ remap[faces[i + 2]] };
+					if (a == b || b == c || a == c) {
+						continue;
+					}
+					faces[kept++] = a;
+					faces[kept++] = b;
+					faces[kept++] = c;
+				}
+				faces.resize(kept);
+			}
+			return faces;
+		}
+
+		float error() const {
+			return static_cast<float>(m_maxError);
+		}
+	};
+}
+
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	size_t targetIndexCount, float& error) {
+	QuadricSimplifier simplifier{ vertices, faces };
+	std::vector<uint32_t> simplified{ simplifier.simplify({ faces.begin(), faces.end() }, targetIndexCount) };
+	error = simplifier.error();
+	return simplified;
+}
+
+void buildLods(MeshData& mesh) {
+	std::vector<Submesh> submeshes{ submeshesOf(mesh) };
+	std::vector<size_t> counts{ submeshVertexCounts(mesh, submeshes) };
+
+	// Each submesh's chain, which may be shorter than the mesh's.
+	struct Chain {
+		std::vector<std::vector<uint32_t>> levels;
+		std::vector<float> errors;
+	};
+	std::vector<Chain> chains(submeshes.size());
+	parallelFor(submeshes.size(), [&](size_t i) {
+		const Submesh& submesh{ submeshes[i] };
+		std::span<const Vertex3D> vertices{ std::span{ mesh.vertices }.subspan(submesh.baseVertex, counts[i]) };
+		std::span<const uint32_t> faces{ std::span{ mesh.faces }.subspan(submesh.indexOffset, submesh.indexCount) };
+		QuadricSimplifier simplifier{ vertices, faces };
+
+		std::vector<uint32_t> previous{ faces.begin(), faces.end() };
+		while (chains[i].levels.size() < MAX_LODS && previous.size() / 3 > LOD_MIN_TRIANGLES) {
+			size_t target{ previous.size() / 6 * 3 };
+			std::vector<uint32_t> level{ simplifier.simplify(previous, target) };
+			if (level.empty() || level.size() > previous.size() * LOD_MIN_REDUCTION) {
+				break;
+			}
+			previous = level;
+			chains[i].levels.push_back(optimizeVertexCache(level, vertices.size()));
+			chains[i].errors.push_back(simplifier.error());
+		}
+	});
+
+	size_t levelCount{ 0 };
+	for (const Chain& chain : chains) {
+		levelCount = std::max(levelCount, chain.levels.size());
+	}
+	// Submeshes whose chain ended early draw their last level (or full detail) at the levels
+	// after it, so every level of the mesh still covers every submesh.
+	mesh.lods.assign(levelCount, MeshLod{ {}, 0 });
+	if (levelCount > 0) {
+		// The faces are no longer all full detail, so the mesh needs its submeshes spelled out.
+		mesh.submeshes = submeshes;
+	}
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		Submesh current{ submeshes[i] };
+		float error{ 0 };
+		for (size_t level{ 0 }; level < levelCount; ++level) {
+			if (level < chains[i].levels.size()) {
+				const std::vector<uint32_t>& faces{ chains[i].levels[level] };
+				current.indexOffset = static_cast<uint32_t>(mesh.faces.size());
+				current.indexCount = static_cast<uint32_t>(faces.size());
+				mesh.faces.insert(mesh.faces.end(), faces.begin(), faces.end());
+				error = chains[i].errors[level];
+			}
+			mesh.lods[level].submeshes.push_back(current);
+			mesh.lods[level].error = std::max(mesh.lods[level].error, error);
+		}
+	}
+}
+
+size_t selectLod(const Mesh& mesh, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight,
+	const LodSettings& settings) {
+	glm::vec3 center{ modelView * glm::vec4{ mesh.bounds.center, 1 } };
+	// The largest scale along any axis, so the sphere stays around the mesh.
+	float scale{ std::sqrt(std::max({ glm::dot(glm::vec3{ modelView[0] }, glm::vec3{ modelView[0] }),
+		glm::dot(glm::vec3{ modelView[1] }, glm::vec3{ modelView[1] }),
+		glm::dot(glm::vec3{ modelView[2] }, glm::vec3{ modelView[2] })
+	})) };
+	float radius{ mesh.bounds.radius * scale };
+	// The camera looks down -z.
+	float distance{ -center.z };
+	if (distance <= radius) {
+		return 0;
+	}
+
+	// Pixels per unit of view space at the sphere's centre, and at its nearest point.
+	float pixelsPerUnit{ projection[1][1] * viewportHeight * 0.5f / distance };
+	if (2 * radius * pixelsPerUnit < settings.cullPixelSize) {
+		return LOD_CULLED;
+	}
+	float nearestPixelsPerUnit{ projection[1][1] * viewportHeight * 0.5f / (distance - radius) };
+	size_t lod{ 0 };
+	for (size_t i{ 0 }; i < mesh.lods.size(); ++i) {
+		if (mesh.lods[i].error * scale * nearestPixelsPerUnit > settings.maxPixelError) {
+			break;
+		}
+		lod = i + 1;
+	}
+	return lod;
+}
@@ -0,0 +1,427 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <span>
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+namespace {
+	// Tuning from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	const size_t FORSYTH_CACHE_SIZE{ 32 };
+	const float CACHE_DECAY_POWER{ 1.5f };
+	const float LAST_TRIANGLE_SCORE{ 0.75f };
+	const float VALENCE_BOOST_SCALE{ 2.0f };
+	const float VALENCE_BOOST_POWER{ 0.5f };
+	// How much worse than the cache-optimized order an overdraw cluster's ACMR may get.
+	const float OVERDRAW_CACHE_THRESHOLD{ 1.05f };
+	// Resolution of the views analyzeOverdraw rasterizes.
+	const size_t OVERDRAW_GRID_SIZE{ 256 };
+	const uint32_t NO_TRIANGLE{ UINT32_MAX };
+
+	glm::vec3 position(const Vertex3D& v) {
+		return glm::vec3{ v.x, v.y, v.z };
+	}
+
+	// Simulates a FIFO vertex cache with timestamps: a vertex is cached if fewer than size misses
+	// happened since it was last loaded.
+	class FifoCache {
+		std::vector<uint64_t> m_loadedAt;
+		uint64_t m_time;
+		size_t m_size;
+
+	public:
+		FifoCache(size_t vertexCount, size_t size)
+			: m_loadedAt(vertexCount, 0), m_time(size + 1), m_size(size) {
+		}
+
+		// Returns 1 if the vertex had to be transformed.
+		uint32_t access(uint32_t vertex) {
+			if (m_time - m_loadedAt[vertex] > m_size) {
+				m_loadedAt[vertex] = m_time++;
+				return 1;
+			}
+			return 0;
+		}
+
+		uint32_t accessTriangle(const uint32_t* corners) {
+			return access(corners[0]) + access(corners[1]) + access(corners[2]);
+		}
+
+		void flush() {
+			m_time += m_size + 1;
+		}
+	};
+
+	float forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f;
+		}
+		float score{ 0 };
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				// Used by the triangle just emitted; a fixed score, so the next triangle isn't
+				// biased towards any one of its edges.
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else {
+				float scale{ 1.0f / (FORSYTH_CACHE_SIZE - 3) };
+				score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+			}
+		}
+		// Favor vertices with few triangles left, to finish them off and keep the frontier small.
+		return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+	}
+
+	// Drops triangles that repeat a corner, or whose corners are collinear.
+	std::vector<uint32_t> removeDegenerates(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces) {
+		std::vector<uint32_t> kept{};
+		kept.reserve(faces.size());
+		for (size_t i{ 0 }; i + 2 < faces.size(); i += 3) {
+			uint32_t a{ faces[i] };
+			uint32_t b{ faces[i + 1] };
+			uint32_t c{ faces[i + 2] };
+			if (a == b || b == c || a == c) {
+				continue;
+			}
+			glm::vec3 origin{ position(vertices[a]) };
+			glm::vec3 normal{ glm::cross(position(vertices[b]) - origin, position(vertices[c]) - origin) };
+			if (normal.x == 0 && normal.y == 0 && normal.z == 0) {
+				continue;
+			}
+			kept.insert(kept.end(), { a, b, c });
+		}
+		return kept;
+	}
+
+	// Splits cache-optimized triangles into clusters that each cost little extra in cache misses
+	// when drawn on their own, then draws the clusters facing away from the mesh's centre first:
+	// from any viewpoint those tend to be in front, so what is behind them fails the depth test.
+	std::vector<uint32_t> sortClustersForOverdraw(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces) {
+		size_t triangleCount{ faces.size() / 3 };
+		FifoCache cache{ vertices.size(), VERTEX_CACHE_ANALYSIS_SIZE };
+
+		// Hard boundaries: where the order already starts over, with a triangle missing on every corner.
+		std::vector<size_t> hardBoundaries{ 0 };
+		for (size_t t{ 0 }; t < triangleCount; ++t) {
+			if (cache.accessTriangle(&faces[t * 3]) == 3 && t > 0) {
+				hardBoundaries.push_back(t);
+			}
+		}
+		hardBoundaries.push_back(triangleCount);
+
+		// Soft boundaries: each hard cluster is cut wherever the ACMR of the piece so far, drawn
+		// after a flush, has come down to within the threshold of the cluster's own.
+		std::vector<size_t> clusterStarts{};
+		for (size_t h{ 0 }; h + 1 < hardBoundaries.size(); ++h) {
+			size_t begin{ hardBoundaries[h] };
+			size_t end{ hardBoundaries[h + 1] };
+			cache.flush();
+			uint32_t misses{ 0 };
+			for (size_t t{ begin }; t < end; ++t) {
+				misses += cache.accessTriangle(&faces[t * 3]);
+			}
+			float threshold{ OVERDRAW_CACHE_THRESHOLD * misses / (end - begin) };
+
+			cache.flush();
+			clusterStarts.push_back(begin);
+			uint32_t pieceMisses{ 0 };
+			size_t pieceStart{ begin };
+			for (size_t t{ begin }; t < end; ++t) {
+				pieceMisses += cache.accessTriangle(&faces[t * 3]);
+				if (t + 1 < end && pieceMisses <= threshold * (t + 1 - pieceStart)) {
+					clusterStarts.push_back(t + 1);
+					pieceStart = t + 1;
+					pieceMisses = 0;
+					cache.flush();
+				}
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		glm::vec3 meshCentroid{ 0 };
+		for (const Vertex3D& v : vertices) {
+			meshCentroid += position(v);
+		}
+		meshCentroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+		// How far each cluster faces out from the centre: its area-weighted centroid's offset,
+		// projected on its area-weighted normal.
+		size_t clusterCount{ clusterStarts.size() - 1 };
+		std::vector<float> outwardness(clusterCount);
+		for (size_t c{ 0 }; c < clusterCount; ++c) {
+			glm::vec3 centroid{ 0 };
+			glm::vec3 normal{ 0 };
+			float area{ 0 };
+			for (size_t t{ clusterStarts[c] }; t < clusterStarts[c + 1]; ++t) {
+				glm::vec3 a{ position(vertices[faces[t * 3]]) };
+				glm::vec3 b{ position(vertices[faces[t * 3 + 1]]) };
+				glm::vec3 p{ position(vertices[faces[t * 3 + 2]]) };
+				glm::vec3 faceNormal{ glm::cross(b - a, p - a) };
+				float faceArea{ glm::length(faceNormal) };
+				centroid += (a + b + p) * (faceArea / 3);
+				normal += faceNormal;
+				area += faceArea;
+			}
+			float normalLength{ glm::length(normal) };
+			if (area > 0 && normalLength > 0) {
+				outwardness[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+			}
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return outwardness[a] > outwardness[b];
+		});
+		std::vector<uint32_t> output{};
+		output.reserve(faces.size());
+		for (uint32_t c : order) {
+			output.insert(output.end(), faces.begin() + clusterStarts[c] * 3, faces.begin() + clusterStarts[c + 1] * 3);
+		}
+		return output;
+	}
+
+	// Numbers vertices in the order the triangles first use them.
+	RebuiltSubmesh optimizeVertexFetch(std::vector<uint32_t> faces, size_t vertexCount) {
+		RebuiltSubmesh part{};
+		std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+		for (uint32_t& index : faces) {
+			if (remap[index] == UINT32_MAX) {
+				remap[index] = static_cast<uint32_t>(part.vertices.size());
+				part.vertices.push_back(index);
+			}
+			index = remap[index];
+		}
+		part.faces = std::move(faces);
+		return part;
+	}
+}
+
+std::vector<uint32_t> optimizeVertexCache(std::span<const uint32_t> faces, size_t vertexCount) {
+	size_t triangleCount{ faces.size() / 3 };
+
+	// The triangles using each vertex, as ranges of one array. The first remaining[v] entries of
+	// a vertex's range are the ones not emitted yet.
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (uint32_t index : faces) {
+		++firstTriangle[index + 1];
+	}
+	std::partial_sum(firstTriangle.begin(), firstTriangle.end(), firstTriangle.begin());
+	std::vector<uint32_t> adjacency(faces.size());
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i{ 0 }; i < faces.size(); ++i) {
+		uint32_t vertex{ faces[i] };
+		adjacency[firstTriangle[vertex] + remaining[vertex]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v{ 0 }; v < vertexCount; ++v) {
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	}
+	auto scoreTriangle{ [&](uint32_t triangle) {
+		const uint32_t* corners{ &faces[triangle * 3] };
+		return vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+	} };
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t best{ NO_TRIANGLE };
+	for (uint32_t t{ 0 }; t < triangleCount; ++t) {
+		triangleScore[t] = scoreTriangle(t);
+		if (best == NO_TRIANGLE || triangleScore[t] > triangleScore[best]) {
+			best = t;
+		}
+	}
+
+	std::vector<uint32_t> cache{};
+	std::vector<uint32_t> nextCache{};
+	std::vector<uint32_t> output{};
+	output.reserve(faces.size());
+	size_t cursor{ 0 };
+	for (size_t count{ 0 }; count < triangleCount; ++count) {
+		if (best == NO_TRIANGLE) {
+			// Nothing in the cache has triangles left; carry on from the first one remaining.
+			while (emitted[cursor]) {
+				++cursor;
+			}
+			best = static_cast<uint32_t>(cursor);
+		}
+		emitted[best] = true;
+		const uint32_t* corners{ &faces[best * 3] };
+		output.insert(output.end(), corners, corners + 3);
+
+		// The emitted triangle's vertices move to the front of the cache.
+		nextCache.assign(corners, corners + 3);
+		for (uint32_t vertex : cache) {
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+		for (size_t k{ 0 }; k < 3; ++k) {
+			uint32_t* begin{ &adjacency[firstTriangle[corners[k]]] };
+			uint32_t* end{ begin + remaining[corners[k]] };
+			std::iter_swap(std::find(begin, end, best), end - 1);
+			--remaining[corners[k]];
+		}
+
+		// Rescore everything that was in either cache, including vertices that just fell out,
+		// then pick the best triangle around the vertices still cached.
+		for (size_t i{ 0 }; i < nextCache.size(); ++i) {
+			uint32_t vertex{ nextCache[i] };
+			cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+			vertexScore[vertex] = forsythVertexScore(cachePosition[vertex], remaining[vertex]);
+		}
+		best = NO_TRIANGLE;
+		for (size_t i{ 0 }; i < nextCache.size(); ++i) {
+			uint32_t vertex{ nextCache[i] };
+			for (uint32_t k{ 0 }; k < remaining[vertex]; ++k) {
+				uint32_t triangle{ adjacency[firstTriangle[vertex] + k] };
+				triangleScore[triangle] = scoreTriangle(triangle);
+				if (i < FORSYTH_CACHE_SIZE && (best == NO_TRIANGLE || triangleScore[triangle] > triangleScore[best])) {
+					best = triangle;
+				}
+			}
+		}
+		nextCache.resize(std::min(nextCache.size(), FORSYTH_CACHE_SIZE));
+		std::swap(cache, nextCache);
+	}
+	return output;
+}
+
+MeshOptimizationReport optimizeMesh(MeshData& mesh, bool optimizeOverdraw, bool analyze) {
+	MeshOptimizationReport report{};
+	report.analyzed = analyze;
+	if (analyze) {
+		report.cacheBefore = analyzeVertexCache(mesh);
+		report.overdrawBefore = analyzeOverdraw(mesh);
+	}
+
+	std::vector<Submesh> submeshes{ submeshesOf(mesh) };
+	std::vector<size_t> counts{ submeshVertexCounts(mesh, submeshes) };
+	std::vector<RebuiltSubmesh> rebuilt(submeshes.size());
+	std::vector<size_t> degenerates(submeshes.size());
+	parallelFor(submeshes.size(), [&](size_t i) {
+		const Submesh& submesh{ submeshes[i] };
+		std::span<const Vertex3D> vertices{ std::span{ mesh.vertices }.subspan(submesh.baseVertex, counts[i]) };
+		std::vector<uint32_t> faces{ removeDegenerates(vertices,
+			std::span{ mesh.faces }.subspan(submesh.indexOffset, submesh.indexCount)) };
+		degenerates[i] = (submesh.indexCount - faces.size()) / 3;
+
+		faces = optimizeVertexCache(faces, vertices.size());
+		if (optimizeOverdraw) {
+			faces = sortClustersForOverdraw(vertices, faces);
+		}
+		rebuilt[i] = optimizeVertexFetch(std::move(faces), vertices.size());
+	});
+	repackSubmeshes(mesh, submeshes, rebuilt);
+
+	report.degenerateTriangles = std::accumulate(degenerates.begin(), degenerates.end(), size_t{ 0 });
+	if (analyze) {
+		report.cacheAfter = analyzeVertexCache(mesh);
+		report.overdrawAfter = analyzeOverdraw(mesh);
+	}
+	return report;
+}
+
+VertexCacheStats analyzeVertexCache(const MeshData& mesh) {
+	FifoCache cache{ mesh.vertices.size(), VERTEX_CACHE_ANALYSIS_SIZE };
+	std::vector<bool> used(mesh.vertices.size(), false);
+	size_t misses{ 0 };
+	size_t usedCount{ 0 };
+	for (const Submesh& submesh : submeshesOf(mesh)) {
+		for (size_t i{ submesh.indexOffset }; i < submesh.indexOffset + submesh.indexCount; ++i) {
+			uint32_t vertex{ static_cast<uint32_t>(submesh.baseVertex + mesh.faces[i]) };
+			misses += cache.access(vertex);
+			if (!used[vertex]) {
+				used[vertex] = true;
+				++usedCount;
+			}
+		}
+	}
+	size_t triangles{ mesh.faces.size() / 3 };
+	return VertexCacheStats{
+		triangles ? static_cast<float>(misses) / triangles : 0,
+		usedCount ? static_cast<float>(misses) / usedCount : 0
+	};
+}
+
+float analyzeOverdraw(const MeshData& mesh) {
+	if (mesh.vertices.empty()) {
+		return 0;
+	}
+	glm::vec3 low{ std::numeric_limits<float>::max() };
+	glm::vec3 high{ std::numeric_limits<float>::lowest() };
+	for (const Vertex3D& v : mesh.vertices) {
+		low = glm::min(low, position(v));
+		high = glm::max(high, position(v));
+	}
+	glm::vec3 size{ high - low };
+	float extent{ std::max({ size.x, size.y, size.z }) };
+	if (extent <= 0) {
+		return 0;
+	}
+	float scale{ (OVERDRAW_GRID_SIZE - 1) / extent };
+	std::vector<Submesh> submeshes{ submeshesOf(mesh) };
+
+	// Looking down each axis from both sides, rasterize every front-facing triangle in draw order
+	// with a depth test, counting the fragments that pass.
+	std::array<size_t, 6> shaded{};
+	std::array<size_t, 6> covered{};
+	parallelFor(6, [&](size_t view) {
+		int axis{ static_cast<int>(view / 2) };
+		float side{ view % 2 == 0 ? 1.0f : -1.0f };
+		int u{ (axis + 1) % 3 };
+		int v{ (axis + 2) % 3 };
+		std::vector<float> depth(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE, std::numeric_limits<float>::max());
+
+		auto project{ [&](uint32_t vertex) {
+			glm::vec3 p{ position(mesh.vertices[vertex]) - low };
+			// Seen from the negative side, the image is mirrored, which also flips the winding.
+			float x{ p[u] * scale };
+			return glm::vec3{ side > 0 ? x : OVERDRAW_GRID_SIZE - 1 - x, p[v] * scale, -side * p[axis] };
+		} };
+		for (const Submesh& submesh : submeshes) {
+			for (size_t i{ submesh.indexOffset }; i + 2 < submesh.indexOffset + submesh.indexCount; i += 3) {
+				glm::vec3 a{ project(submesh.baseVertex + mesh.faces[i]) };
+				glm::vec3 b{ project(submesh.baseVertex + mesh.faces[i + 1]) };
+				glm::vec3 c{ project(submesh.baseVertex + mesh.faces[i + 2]) };
+				float area{ (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y) };
+				if (area <= 0) {
+					continue;
+				}
+				int minX{ std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x })))) };
+				int maxX{ std::min(static_cast<int>(OVERDRAW_GRID_SIZE) - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x })))) };
+				int minY{ std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y })))) };
+				int maxY{ std::min(static_cast<int>(OVERDRAW_GRID_SIZE) - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y })))) };
+				for (int y{ minY }; y <= maxY; ++y) {
+					for (int x{ minX }; x <= maxX; ++x) {
+						float px{ x + 0.5f };
+						float py{ y + 0.5f };
+						float wa{ ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py)) / area };
+						float wb{ ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py)) / area };
+						float wc{ 1 - wa - wb };
+						if (wa < 0 || wb < 0 || wc < 0) {
+							continue;
+						}
+						float z{ wa * a.z + wb * b.z + wc * c.z };
+						float& stored{ depth[y * OVERDRAW_GRID_SIZE + x] };
+						if (z < stored) {
+							stored = z;
+							++shaded[view];
+						}
+					}
+				}
+			}
+		}
+		covered[view] = std::count_if(depth.begin(), depth.end(), [](float z) {
+			return z != std::numeric_limits<float>::max();
+		});
+	});
+
+	size_t totalShaded{ std::accumulate(shaded.begin(), shaded.end(), size_t{ 0 }) };
+	size_t totalCovered{ std::accumulate(covered.begin(), covered.end(), size_t{ 0 }) };
+	return totalCovered ? static_cast<float>(totalShaded) / totalCovered : 0;
+}
@@ -0,0 +1,495 @@
+#include "MeshProcessing.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <span>
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESH_PROCESSING_SSE2
+#endif
+
+namespace {
+	// Vertices processed by one task when a step is split by vertex range.
+	const size_t VERTEX_BLOCK_SIZE{ 64 * 1024 };
+	// Triangles processed by one task when a step is split by triangle range.
+	const size_t TRIANGLE_BLOCK_SIZE{ 16 * 1024 };
+
+	// What weldVertices compares: the snapped position, normal (or zeros), texture coordinates (or
+	// zeros) and owning submesh. Comparisons take the submesh as given, and check it separately when
+	// it might differ.
+	using WeldKey = std::array<uint32_t, 9>;
+
+	// A cell of the weld grid, or the value's own bits if the tolerance is 0. Adding 0 turns -0 into
+	// 0, so the two still match.
+	uint32_t snap(float value, float cellsPerUnit) {
+		if (cellsPerUnit == 0) {
+			return std::bit_cast<uint32_t>(value + 0.0f);
+		}
+		double cell{ std::floor(static_cast<double>(value) * cellsPerUnit + 0.5) };
+		return static_cast<uint32_t>(static_cast<int64_t>(std::clamp(cell, -2147483648.0, 2147483647.0)));
+	}
+
+	// Mixes the key's words with the 64-bit finalizer from MurmurHash3, which spreads the
+	// neighbouring grid cells of a scan across the whole table.
+	uint64_t hashWeldKey(const WeldKey& key) {
+		uint64_t hash{ 0 };
+		for (uint32_t word : key) {
+			hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+			hash ^= hash >> 33;
+		}
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		return hash ^ (hash >> 33);
+	}
+
+	// Vector sums, and the cross products that feed them, four lanes at a time where SSE2 is
+	// available.
+#ifdef MESH_PROCESSING_SSE2
+	// Adds value * weight to sum.
+	void accumulate(glm::vec4& sum, const glm::vec4& value, float weight) {
+		__m128 scaled{ _mm_mul_ps(_mm_loadu_ps(&value[0]), _mm_set1_ps(weight)) };
+		_mm_storeu_ps(&sum[0], _mm_add_ps(_mm_loadu_ps(&sum[0]), scaled));
+	}
+
+	__m128 loadPosition(const Vertex3D& v) {
+		return _mm_set_ps(0, v.z, v.y, v.x);
+	}
+
+	// The cross product of b - a and c - a, with a w of 0: twice the triangle's area as its length.
+	glm::vec4 triangleCross(const Vertex3D& a, const Vertex3D& b, const Vertex3D& c) {
+		__m128 origin{ loadPosition(a) };
+		__m128 u{ _mm_sub_ps(loadPosition(b), origin) };
+		__m128 v{ _mm_sub_ps(loadPosition(c), origin) };
+		// u.yzx * v.zxy - u.zxy * v.yzx
+		__m128 cross{ _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2))),
+			_mm_mul_ps(_mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)))) };
+		glm::vec4 result;
+		_mm_storeu_ps(&result[0], cross);
+		return result;
+	}
+#else
+	void accumulate(glm::vec4& sum, const glm::vec4& value, float weight) {
+		sum += value * weight;
+	}
+
+	glm::vec4 triangleCross(const Vertex3D& a, const Vertex3D& b, const Vertex3D& c) {
+		return glm::vec4{ glm::cross(
+			glm::vec3{ b.x - a.x, b.y - a.y, b.z - a.z }, glm::vec3{ c.x - a.x, c.y - a.y, c.z - a.z }), 0 };
+	}
+#endif
+
+	glm::vec3 position(const Vertex3D& v) {
+		return glm::vec3{ v.x, v.y, v.z };
+	}
+
+	// A range of the index buffer, and the vertex its indices count from.
+	struct TriangleBlock {
+		size_t first;
+		size_t last;
+		int32_t baseVertex;
+	};
+
+	// Every submesh's triangles, in blocks of up to TRIANGLE_BLOCK_SIZE, so one huge submesh is still
+	// split across every core.
+	std::vector<TriangleBlock> triangleBlocks(const std::vector<Submesh>& submeshes) {
+		std::vector<TriangleBlock> blocks{};
+		for (const Submesh& submesh : submeshes) {
+			size_t end{ static_cast<size_t>(submesh.indexOffset) + submesh.indexCount / 3 * 3 };
+			for (size_t first{ submesh.indexOffset }; first < end; first += TRIANGLE_BLOCK_SIZE * 3) {
+				blocks.push_back(TriangleBlock{ first, std::min(first + TRIANGLE_BLOCK_SIZE * 3, end), submesh.baseVertex });
+			}
+		}
+		return blocks;
+	}
+
+	// Each triangle's angle at each of its corners, indexed like the index buffer. All three share
+	// the triangle's cross product, so each is the atan2 of that and the dot product of its edges.
+	void cornerAngles(const MeshData& mesh, const TriangleBlock& block, std::vector<float>& angles) {
+		for (size_t index{ block.first }; index < block.last; index += 3) {
+			glm::vec3 corners[3]{};
+			for (size_t k{ 0 }; k < 3; ++k) {
+				corners[k] = position(mesh.vertices[block.baseVertex + mesh.faces[index + k]]);
+			}
+			float doubleArea{ glm::length(glm::cross(corners[1] - corners[0], corners[2] - corners[0])) };
+			for (size_t k{ 0 }; k < 3; ++k) {
+				glm::vec3 toNext{ corners[(k + 1) % 3] - corners[k] };
+				glm::vec3 toPrevious{ corners[(k + 2) % 3] - corners[k] };
+				angles[index + k] = std::atan2(doubleArea, glm::dot(toNext, toPrevious));
+			}
+		}
+	}
+
+	// Every triangle corner (its position in the index buffer, and its vertex), grouped by the block
+	// of VERTEX_BLOCK_SIZE vertices its vertex is in: block b's are entries first[b] to first[b + 1],
+	// in index buffer order. Each task can then gather the triangles around its own vertices without
+	// atomics, and without reading every triangle. Corners are counted and placed from every
+	// triangle block in parallel.
+	struct CornerBuckets {
+		std::vector<size_t> first;
+		std::vector<uint32_t> corners;
+		std::vector<uint32_t> vertices;
+	};
+
+	CornerBuckets bucketCorners(const MeshData& mesh, const std::vector<TriangleBlock>& blocks) {
+		size_t vertexBlocks{ (mesh.vertices.size() + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE };
+		// Each triangle block's count of corners in each vertex block, then where it puts the next one.
+		std::vector<size_t> places(blocks.size() * vertexBlocks, 0);
+		parallelFor(blocks.size(), [&](size_t b) {
+			size_t* counts{ places.data() + b * vertexBlocks };
+			for (size_t index{ blocks[b].first }; index < blocks[b].last; ++index) {
+				++counts[(blocks[b].baseVertex + mesh.faces[index]) / VERTEX_BLOCK_SIZE];
+			}
+		});
+
+		CornerBuckets buckets{};
+		buckets.first.resize(vertexBlocks + 1);
+		size_t total{ 0 };
+		for (size_t v{ 0 }; v < vertexBlocks; ++v) {
+			buckets.first[v] = total;
+			for (size_t b{ 0 }; b < blocks.size(); ++b) {
+				size_t count{ places[b * vertexBlocks + v] };
+				places[b * vertexBlocks + v] = total;
+				total += count;
+			}
+		}
+		buckets.first[vertexBlocks] = total;
+		buckets.corners.resize(total);
+		buckets.vertices.resize(total);
+		parallelFor(blocks.size(), [&](size_t b) {
+			size_t* next{ places.data() + b * vertexBlocks };
+			for (size_t index{ blocks[b].first }; index < blocks[b].last; ++index) {
+				uint32_t vertex{ static_cast<uint32_t>(blocks[b].baseVertex + mesh.faces[index]) };
+				size_t place{ next[vertex / VERTEX_BLOCK_SIZE]++ };
+				buckets.corners[place] = static_cast<uint32_t>(index);
+				buckets.vertices[place] = vertex;
+			}
+		});
+		return buckets;
+	}
+}
+
+std::vector<Submesh> submeshesOf(const MeshData& mesh) {
+	if (!mesh.submeshes.empty()) {
+		return mesh.submeshes;
+	}
+	return { Submesh{ 0, static_cast<uint32_t>(mesh.faces.size()), 0 } };
+}
+
+std::vector<size_t> submeshVertexCounts(const MeshData& mesh, const std::vector<Submesh>& submeshes) {
+	std::vector<int32_t> starts(submeshes.size());
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		starts[i] = submeshes[i].baseVertex;
+	}
+	std::sort(starts.begin(), starts.end());
+
+	std::vector<size_t> counts(submeshes.size());
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		auto next{ std::upper_bound(starts.begin(), starts.end(), submeshes[i].baseVertex) };
+		size_t end{ next == starts.end() ? mesh.vertices.size() : static_cast<size_t>(*next) };
+		counts[i] = end - submeshes[i].baseVertex;
+	}
+	return counts;
+}
+
+void repackSubmeshes(MeshData& mesh, const std::vector<Submesh>& submeshes,
+	const std::vector<RebuiltSubmesh>& rebuilt) {
+	bool hasNormals{ !mesh.normals.empty() };
+	bool hasTexCoords{ !mesh.texCoords.empty() };
+	bool hasTangents{ !mesh.tangents.empty() };
+	std::vector<Submesh> packed(submeshes.size());
+	size_t vertexCount{ 0 };
+	size_t indexCount{ 0 };
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		packed[i] = Submesh{ static_cast<uint32_t>(indexCount), static_cast<uint32_t>(rebuilt[i].faces.size()),
+			static_cast<int32_t>(vertexCount) };
+		vertexCount += rebuilt[i].vertices.size();
+		indexCount += rebuilt[i].faces.size();
+	}
+
+	std::vector<Vertex3D> vertices(vertexCount);
+	std::vector<glm::vec3> normals(hasNormals ? vertexCount : 0);
+	std::vector<glm::vec2> texCoords(hasTexCoords ? vertexCount : 0);
+	std::vector<glm::vec4> tangents(hasTangents ? vertexCount : 0);
+	std::vector<uint32_t> faces(indexCount);
+	parallelFor(submeshes.size(), [&](size_t i) {
+		const RebuiltSubmesh& part{ rebuilt[i] };
+		for (size_t k{ 0 }; k < part.vertices.size(); ++k) {
+			size_t from{ submeshes[i].baseVertex + part.vertices[k] };
+			vertices[packed[i].baseVertex + k] = mesh.vertices[from];
+			if (hasNormals) {
+				normals[packed[i].baseVertex + k] = mesh.normals[from];
+			}
+			if (hasTexCoords) {
+				texCoords[packed[i].baseVertex + k] = mesh.texCoords[from];
+			}
+			if (hasTangents) {
+				tangents[packed[i].baseVertex + k] = mesh.tangents[from];
+			}
+		}
+		std::copy(part.faces.begin(), part.faces.end(), faces.begin() + packed[i].indexOffset);
+	});
+
+	mesh.vertices = std::move(vertices);
+	mesh.normals = std::move(normals);
+	mesh.texCoords = std::move(texCoords);
+	mesh.tangents = std::move(tangents);
+	mesh.faces = std::move(faces);
+	mesh.lods.clear();
+	mesh.meshlets.clear();
+	if (!mesh.submeshes.empty()) {
+		mesh.submeshes = std::move(packed);
+	}
+}
+
+void weldVertices(MeshData& mesh, const WeldSettings& settings) {
+	std::vector<Submesh> submeshes{ submeshesOf(mesh) };
+	std::vector<size_t> counts{ submeshVertexCounts(mesh, submeshes) };
+	bool matchNormals{ settings.matchNormals && !mesh.normals.empty() };
+	bool matchTexCoords{ !mesh.texCoords.empty() };
+	float positionCells{ settings.positionTolerance > 0 ? 1 / settings.positionTolerance : 0 };
+	float normalCells{ settings.normalTolerance > 0 ? 1 / settings.normalTolerance : 0 };
+
+	// Blocks of each submesh's vertices, so the owning submesh can be part of the key.
+	struct VertexBlock {
+		size_t first;
+		size_t last;
+		uint32_t submesh;
+	};
+	std::vector<VertexBlock> blocks{};
+	for (size_t i{ 0 }; i < submeshes.size(); ++i) {
+		size_t end{ submeshes[i].baseVertex + counts[i] };
+		for (size_t first{ static_cast<size_t>(submeshes[i].baseVertex) }; first < end; first += VERTEX_BLOCK_SIZE) {
+			blocks.push_back(VertexBlock{ first, std::min(first + VERTEX_BLOCK_SIZE, end), static_cast<uint32_t>(i) });
+		}
+	}
+	std::sort(blocks.begin(), blocks.end(), [](const VertexBlock& a, const VertexBlock& b) {
+		return a.first < b.first;
+	});
+	auto ownerOf{ [&](size_t vertex) {
+		auto next{ std::upper_bound(blocks.begin(), blocks.end(), vertex, [](size_t v, const VertexBlock& block) {
+			return v < block.first;
+		}) };
+		return std::prev(next)->submesh;
+	} };
+	auto keyOf{ [&](size_t vertex, uint32_t submesh) {
+		const Vertex3D& v{ mesh.vertices[vertex] };
+		WeldKey key{ snap(v.x, positionCells), snap(v.y, positionCells), snap(v.z, positionCells), 0, 0, 0, 0, 0, submesh };
+		if (matchNormals) {
+			const glm::vec3& n{ mesh.normals[vertex] };
+			key[3] = snap(n.x, normalCells);
+			key[4] = snap(n.y, normalCells);
+			key[5] = snap(n.z, normalCells);
+		}
+		if (matchTexCoords) {
+			key[6] = snap(mesh.texCoords[vertex].x, 0);
+			key[7] = snap(mesh.texCoords[vertex].y, 0);
+		}
+		return key;
+	} };
+
+	// Slots hold a vertex plus one, or 0 if empty. Every vertex inserts itself and lowers its
+	// group's slot to the smallest vertex of the group; a slot never changes group once taken, so
+	// threads only race on claiming empty slots and on lowering. Kept at most half full.
+	size_t tableSize{ std::bit_ceil(std::max<size_t>(mesh.vertices.size() * 2, 2)) };
+	size_t mask{ tableSize - 1 };
+	std::unique_ptr<std::atomic<uint32_t>[]> table{ new std::atomic<uint32_t>[tableSize] };
+	parallelFor((tableSize + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE, [&](size_t block) {
+		for (size_t slot{ block * VERTEX_BLOCK_SIZE }; slot < std::min((block + 1) * VERTEX_BLOCK_SIZE, tableSize); ++slot) {
+			table[slot].store(0, std::memory_order_relaxed);
+		}
+	});
+	// First the slot of each vertex's group, then the group's vertex.
+	std::vector<uint32_t> canonical(mesh.vertices.size());
+	parallelFor(blocks.size(), [&](size_t b) {
+		const VertexBlock& block{ blocks[b] };
+		for (size_t vertex{ block.first }; vertex < block.last; ++vertex) {
+			WeldKey key{ keyOf(vertex, block.submesh) };
+			uint32_t value{ static_cast<uint32_t>(vertex + 1) };
+			size_t slot{ hashWeldKey(key) & mask };
+			uint32_t current{ table[slot].load(std::memory_order_relaxed) };
+			while (true) {
+				if (current == 0) {
+					// On failure, current is reloaded with whoever took the slot first.
+					if (table[slot].compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if (keyOf(current - 1, block.submesh) != key
+					|| ((current - 1 < block.first || current - 1 >= block.last) && ownerOf(current - 1) != block.submesh)) {
+					slot = (slot + 1) & mask;
+					current = table[slot].load(std::memory_order_relaxed);
+				}
+				else if (current <= value
+					|| table[slot].compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			canonical[vertex] = static_cast<uint32_t>(slot);
+		}
+	});
+	parallelFor(blocks.size(), [&](size_t b) {
+		for (size_t vertex{ blocks[b].first }; vertex < blocks[b].last; ++vertex) {
+			canonical[vertex] = table[canonical[vertex]].load(std::memory_order_relaxed) - 1;
+		}
+	});
+	table.reset();
+
+	// Each submesh keeps its vertices in order of first use.
+	std::vector<RebuiltSubmesh> rebuilt(submeshes.size());
+	parallelFor(submeshes.size(), [&](size_t i) {
+		const Submesh& submesh{ submeshes[i] };
+		std::span<const uint32_t> faces{ std::span{ mesh.faces }.subspan(submesh.indexOffset, submesh.indexCount) };
+		const uint32_t* groups{ canonical.data() + submesh.baseVertex };
+		RebuiltSubmesh& part{ rebuilt[i] };
+
+		// Group's vertex -> new vertex, filled in as groups are first used.
+		std::vector<uint32_t> remap(counts[i], UINT32_MAX);
+		part.faces.resize(faces.size());
+		for (size_t f{ 0 }; f < faces.size(); ++f) {
+			uint32_t group{ groups[faces[f]] - static_cast<uint32_t>(submesh.baseVertex) };
+			if (remap[group] == UINT32_MAX) {
+				remap[group] = static_cast<uint32_t>(part.vertices.size());
+				part.vertices.push_back(group);
+			}
+			part.faces[f] = remap[group];
+		}
+	});
+	repackSubmeshes(mesh, submeshes, rebuilt);
+}
+
+void joinIdenticalVertices(MeshData& mesh) {
+	weldVertices(mesh, EXACT_WELD);
+}
+
+void generateNormals(MeshData& mesh, NormalWeighting weighting) {
+	std::vector<TriangleBlock> blocks{ triangleBlocks(submeshesOf(mesh)) };
+	bool byAngle{ weighting == NormalWeighting::Angle };
+
+	// Face normals, indexed by the triangle's position in the index buffer: area-weighted ones, with
+	// twice the triangle's area as their length, or unit ones to be weighted by angle.
+	std::vector<glm::vec4> faceNormals(mesh.faces.size() / 3);
+	std::vector<float> angles(byAngle ? mesh.faces.size() : 0);
+	parallelFor(blocks.size(), [&](size_t b) {
+		const TriangleBlock& block{ blocks[b] };
+		for (size_t index{ block.first }; index < block.last; index += 3) {
+			const Vertex3D* vertices{ mesh.vertices.data() + block.baseVertex };
+			glm::vec4 normal{ triangleCross(vertices[mesh.faces[index]], vertices[mesh.faces[index + 1]],
+				vertices[mesh.faces[index + 2]]) };
+			float length{ glm::length(glm::vec3{ normal }) };
+			faceNormals[index / 3] = byAngle && length > 0 ? normal / length : normal;
+		}
+		if (byAngle) {
+			cornerAngles(mesh, block, angles);
+		}
+	});
+
+	// Each task sums the triangles around its own block of vertices, so no two write the same normal.
+	CornerBuckets buckets{ bucketCorners(mesh, blocks) };
+	mesh.normals.resize(mesh.vertices.size());
+	parallelFor(buckets.first.size() - 1, [&](size_t block) {
+		size_t first{ block * VERTEX_BLOCK_SIZE };
+		size_t last{ std::min(first + VERTEX_BLOCK_SIZE, mesh.vertices.size()) };
+		std::vector<glm::vec4> sums(last - first, glm::vec4{ 0 });
+		for (size_t c{ buckets.first[block] }; c < buckets.first[block + 1]; ++c) {
+			uint32_t corner{ buckets.corners[c] };
+			accumulate(sums[buckets.vertices[c] - first], faceNormals[corner / 3], byAngle ? angles[corner] : 1.0f);
+		}
+		for (size_t v{ first }; v < last; ++v) {
+			glm::vec3 normal{ sums[v - first] };
+			float length{ glm::length(normal) };
+			mesh.normals[v] = length > 0 ? normal / length : glm::vec3{ 0 };
+		}
+	});
+}
+
+void generateTangents(MeshData& mesh) {
+	if (mesh.texCoords.empty()) {
+		return;
+	}
+	if (mesh.normals.empty()) {
+		generateNormals(mesh);
+	}
+	std::vector<TriangleBlock> blocks{ triangleBlocks(submeshesOf(mesh)) };
+
+	// Each triangle's unit direction of increasing u, with its orientation in texture space in w: 1
+	// or -1, the handedness its corners get. Indexed by its position in the index buffer; zero for a
+	// triangle whose texture coordinates have no area.
+	std::vector<glm::vec4> faceTangents(mesh.faces.size() / 3);
+	parallelFor(blocks.size(), [&](size_t b) {
+		const TriangleBlock& block{ blocks[b] };
+		for (size_t index{ block.first }; index < block.last; index += 3) {
+			uint32_t corners[3]{};
+			for (size_t k{ 0 }; k < 3; ++k) {
+				corners[k] = static_cast<uint32_t>(block.baseVertex + mesh.faces[index + k]);
+			}
+			glm::vec3 edge1{ position(mesh.vertices[corners[1]]) - position(mesh.vertices[corners[0]]) };
+			glm::vec3 edge2{ position(mesh.vertices[corners[2]]) - position(mesh.vertices[corners[0]]) };
+			glm::vec2 uv1{ mesh.texCoords[corners[1]] - mesh.texCoords[corners[0]] };
+			glm::vec2 uv2{ mesh.texCoords[corners[2]] - mesh.texCoords[corners[0]] };
+			// The sign of the UV area, which is all that matters once the direction is normalized.
+			float determinant{ uv1.x * uv2.y - uv2.x * uv1.y };
+			float sign{ determinant < 0 ? -1.0f : 1.0f };
+			glm::vec3 tangent{ (edge1 * uv2.y - edge2 * uv1.y) * sign };
+			if (determinant != 0 && glm::length(tangent) > 0) {
+				faceTangents[index / 3] = glm::vec4{ glm::normalize(tangent), sign };
+			}
+		}
+	});
+
+	// As MikkTSpace does, each corner's tangent is projected onto the plane of the vertex's normal
+	// and normalized before it is weighted by the corner's angle, also measured in that plane.
+	// MikkTSpace splits a vertex whose triangles have both orientations; here the vertex takes the
+	// orientation with the larger total angle, and only those triangles' tangents.
+	CornerBuckets buckets{ bucketCorners(mesh, blocks) };
+	mesh.tangents.resize(mesh.vertices.size());
+	parallelFor(buckets.first.size() - 1, [&](size_t block) {
+		size_t first{ block * VERTEX_BLOCK_SIZE };
+		size_t last{ std::min(first + VERTEX_BLOCK_SIZE, mesh.vertices.size()) };
+		// Per vertex, the sums for right-handed triangles then left-handed ones, with the angles
+		// summed in w.
+		std::vector<glm::vec4> sums(2 * (last - first), glm::vec4{ 0 });
+		for (size_t c{ buckets.first[block] }; c < buckets.first[block + 1]; ++c) {
+			uint32_t corner{ buckets.corners[c] };
+			const glm::vec4& face{ faceTangents[corner / 3] };
+			if (face.w == 0) {
+				continue;
+			}
+			uint32_t vertex{ buckets.vertices[c] };
+			const glm::vec3& normal{ mesh.normals[vertex] };
+			auto project{ [&](const glm::vec3& direction) {
+				glm::vec3 projected{ direction - normal * glm::dot(normal, direction) };
+				float length{ glm::length(projected) };
+				return length > 0 ? projected / length : projected;
+			} };
+			glm::vec3 tangent{ project(glm::vec3{ face }) };
+			// Indices are relative to the submesh's base vertex, which this corner's vertex gives.
+			size_t triangle{ corner - corner % 3 };
+			size_t base{ vertex - mesh.faces[corner] };
+			glm::vec3 origin{ position(mesh.vertices[vertex]) };
+			glm::vec3 toNext{ project(position(mesh.vertices[base + mesh.faces[triangle + (corner + 1) % 3]]) - origin) };
+			glm::vec3 toPrevious{ project(position(mesh.vertices[base + mesh.faces[triangle + (corner + 2) % 3]]) - origin) };
+			float angle{ std::acos(std::clamp(glm::dot(toNext, toPrevious), -1.0f, 1.0f)) };
+			accumulate(sums[2 * (vertex - first) + (face.w < 0 ? 1 : 0)], glm::vec4{ tangent, 1 }, angle);
+		}
+		for (size_t v{ first }; v < last; ++v) {
+			const glm::vec3& normal{ mesh.normals[v] };
+			const glm::vec4& right{ sums[2 * (v - first)] };
+			const glm::vec4& left{ sums[2 * (v - first) + 1] };
+			bool leftHanded{ left.w > right.w };
+			glm::vec3 tangent{ leftHanded ? left : right };
+			if (glm::length(tangent) == 0) {
+				// No usable triangles; any direction in the plane will do.
+				tangent = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3{ 1, 0, 0 } : glm::vec3{ 0, 1, 0 });
+			}
+			if (glm::length(tangent) > 0) {
+				tangent = glm::normalize(tangent);
+			}
+			mesh.tangents[v] = glm::vec4{ tangent, leftHanded ? -1.0f : 1.0f };
+		}
+	});
+}
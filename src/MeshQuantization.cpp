@@ -0,0 +1,186 @@
+#include "MeshQuantization.h"
+#include <glm/ext.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Bounds.h"
+#include "Parallel.h"
+
+namespace {
+	const float SHORT_MAX{ 65535.0f };
+	const float SIGNED_SHORT_MAX{ 32767.0f };
+	// Vertices encoded by one task.
+	const size_t ENCODE_BLOCK_SIZE{ 64 * 1024 };
+
+	float signNotZero(float value) {
+		return value >= 0 ? 1.0f : -1.0f;
+	}
+
+	uint16_t quantizeUnorm(float value, float scale) {
+		return static_cast<uint16_t>(std::clamp(std::round(value * scale), 0.0f, SHORT_MAX));
+	}
+
+	int16_t quantizeSnorm(float value) {
+		return static_cast<int16_t>(std::clamp(std::round(value * SIGNED_SHORT_MAX), -SIGNED_SHORT_MAX, SIGNED_SHORT_MAX));
+	}
+}
+
+glm::mat4 PositionQuantization::transform() const {
+	return glm::scale(glm::translate(glm::mat4{ 1 }, offset), scale);
+}
+
+PositionQuantization positionQuantization(std::span<const Vertex3D> vertices) {
+	if (vertices.empty()) {
+		return PositionQuantization{ glm::vec3{ 0 }, glm::vec3{ 1 } };
+	}
+	return positionQuantization(boundingBox(vertices));
+}
+
+PositionQuantization positionQuantization(const BoundingBox& box) {
+	return PositionQuantization{ box.low, box.high - box.low };
+}
+
+QuantizedPosition quantizePosition(const Vertex3D& vertex, const PositionQuantization& quantization) {
+	// A flat axis has no extent to spread over; everything on it quantizes to 0.
+	auto quantize{ [](float value, float offset, float scale) {
+		return scale > 0 ? quantizeUnorm((value - offset) / scale, SHORT_MAX) : uint16_t{ 0 };
+	} };
+	return QuantizedPosition{
+		quantize(vertex.x, quantization.offset.x, quantization.scale.x),
+		quantize(vertex.y, quantization.offset.y, quantization.scale.y),
+		quantize(vertex.z, quantization.offset.z, quantization.scale.z),
+		0
+	};
+}
+
+glm::vec3 dequantizePosition(const QuantizedPosition& position, const PositionQuantization& quantization) {
+	return quantization.offset + glm::vec3{ position.x, position.y, position.z } / SHORT_MAX * quantization.scale;
+}
+
+OctahedralNormal encodeOctahedral(const glm::vec3& normal) {
+	float sum{ std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) };
+	if (sum == 0) {
+		return OctahedralNormal{ 0, 0 };
+	}
+	float x{ normal.x / sum };
+	float y{ normal.y / sum };
+	if (normal.z < 0) {
+		// Fold the lower half of the octahedron over the upper one.
+		float foldedX{ (1 - std::abs(y)) * signNotZero(x) };
+		y = (1 - std::abs(x)) * signNotZero(y);
+		x = foldedX;
+	}
+	return OctahedralNormal{ quantizeSnorm(x), quantizeSnorm(y) };
+}
+
+ShortTangent encodeTangent(const glm::vec4& tangent) {
+	return ShortTangent{ quantizeSnorm(tangent.x), quantizeSnorm(tangent.y), quantizeSnorm(tangent.z), quantizeSnorm(tangent.w) };
+}
+
+glm::vec3 decodeOctahedral(const OctahedralNormal& normal) {
+	// Matches vertexNormal() in vertex_attributes.glsl.
+	float x{ std::max(normal.x / SIGNED_SHORT_MAX, -1.0f) };
+	float y{ std::max(normal.y / SIGNED_SHORT_MAX, -1.0f) };
+	glm::vec3 n{ x, y, 1 - std::abs(x) - std::abs(y) };
+	if (n.z < 0) {
+		n.x = (1 - std::abs(y)) * signNotZero(x);
+		n.y = (1 - std::abs(x)) * signNotZero(y);
+	}
+	return glm::normalize(n);
+}
+
+EncodedVertices encodeVertices(std::span<const Vertex3D> vertices, const VertexAttributes& attributes,
+	VertexEncoding encoding) {
+	return encodeVertices(vertices, attributes, encoding, positionQuantization(vertices));
+}
+
+EncodedVertices encodeVertices(std::span<const Vertex3D> vertices, const VertexAttributes& attributes,
+	VertexEncoding encoding, const PositionQuantization& quantization) {
+	std::span<const glm::vec3> normals{ attributes.normals };
+	std::span<const glm::vec4> tangents{ attributes.tangents };
+	std::span<const glm::vec2> texCoords{ attributes.texCoords };
+	uint32_t positionSize{ static_cast<uint32_t>(encoding.quantizePositions ? sizeof(QuantizedPosition) : sizeof(Vertex3D)) };
+	uint32_t normalSize{ 0 };
+	if (!normals.empty()) {
+		normalSize = static_cast<uint32_t>(encoding.octahedralNormals ? sizeof(OctahedralNormal) : sizeof(glm::vec3));
+	}
+	uint32_t tangentSize{ 0 };
+	if (!tangents.empty()) {
+		tangentSize = static_cast<uint32_t>(encoding.octahedralNormals ? sizeof(ShortTangent) : sizeof(glm::vec4));
+	}
+	uint32_t texCoordSize{ static_cast<uint32_t>(texCoords.empty() ? 0 : sizeof(glm::vec2)) };
+
+	EncodedVertices encoded{};
+	encoded.normalOffset = normals.empty() ? 0 : positionSize;
+	encoded.tangentOffset = tangents.empty() ? 0 : positionSize + normalSize;
+	encoded.texCoordOffset = texCoords.empty() ? 0 : positionSize + normalSize + tangentSize;
+	encoded.stride = positionSize + normalSize + tangentSize + texCoordSize;
+	encoded.positionTransform = encoding.quantizePositions ? quantization.transform() : glm::mat4{ 1 };
+	encoded.data.resize(vertices.size() * encoded.stride);
+
+	size_t blocks{ (vertices.size() + ENCODE_BLOCK_SIZE - 1) / ENCODE_BLOCK_SIZE };
+	std::vector<float> positionErrors(blocks);
+	std::vector<float> normalErrors(blocks);
+	parallelFor(blocks, [&](size_t block) {
+		size_t end{ std::min(vertices.size(), (block + 1) * ENCODE_BLOCK_SIZE) };
+		for (size_t i{ block * ENCODE_BLOCK_SIZE }; i < end; ++i) {
+			std::byte* out{ encoded.data.data() + i * encoded.stride };
+			const Vertex3D& vertex{ vertices[i] };
+			if (encoding.quantizePositions) {
+				QuantizedPosition position{ quantizePosition(vertex, quantization) };
+				std::memcpy(out, &position, sizeof(position));
+				glm::vec3 error{ glm::abs(dequantizePosition(position, quantization) - glm::vec3{ vertex.x, vertex.y, vertex.z }) };
+				positionErrors[block] = std::max({ positionErrors[block], error.x, error.y, error.z });
+			}
+			else {
+				std::memcpy(out, &vertex, sizeof(vertex));
+			}
+
+			if (!normals.empty()) {
+				if (encoding.octahedralNormals) {
+					OctahedralNormal normal{ encodeOctahedral(normals[i]) };
+					std::memcpy(out + encoded.normalOffset, &normal, sizeof(normal));
+					float length{ glm::length(normals[i]) };
+					if (length > 0) {
+						float cosine{ std::clamp(glm::dot(decodeOctahedral(normal), normals[i] / length), -1.0f, 1.0f) };
+						normalErrors[block] = std::max(normalErrors[block], glm::degrees(std::acos(cosine)));
+					}
+				}
+				else {
+					std::memcpy(out + encoded.normalOffset, &normals[i], sizeof(glm::vec3));
+				}
+			}
+			if (!tangents.empty()) {
+				if (encoding.octahedralNormals) {
+					ShortTangent tangent{ encodeTangent(tangents[i]) };
+					std::memcpy(out + encoded.tangentOffset, &tangent, sizeof(tangent));
+				}
+				else {
+					std::memcpy(out + encoded.tangentOffset, &tangents[i], sizeof(glm::vec4));
+				}
+			}
+			if (!texCoords.empty()) {
+				std::memcpy(out + encoded.texCoordOffset, &texCoords[i], sizeof(glm::vec2));
+			}
+		}
+	});
+	for (size_t block{ 0 }; block < blocks; ++block) {
+		encoded.positionError = std::max(encoded.positionError, positionErrors[block]);
+		encoded.normalError = std::max(encoded.normalError, normalErrors[block]);
+	}
+	return encoded;
+}
+
+bool fitsShortIndices(std::span<const uint32_t> faces) {
+	return std::all_of(faces.begin(), faces.end(), [](uint32_t index) {
+		return index <= UINT16_MAX;
+	});
+}
+
+std::vector<uint16_t> narrowIndices(std::span<const uint32_t> faces) {
+	std::vector<uint16_t> narrow(faces.size());
+	std::transform(faces.begin(), faces.end(), narrow.begin(), [](uint32_t index) {
+		return static_cast<uint16_t>(index);
+	});
+	return narrow;
+}
@@ -0,0 +1,264 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <span>
+#include "Bounds.h"
+#include "MeshOptimizer.h"
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+namespace {
+	// Past MESHLET_MIN_TRIANGLES, a triangle whose normal is further than this from the meshlet's
+	// average normal (about 45 degrees) starts a new meshlet, which keeps the cones narrow enough to
+	// cull.
+	const float MESHLET_SPLIT_COS{ 0.7f };
+
+	glm::vec3 position(const Vertex3D& v) {
+		return glm::vec3{ v.x, v.y, v.z };
+	}
+
+	// The unit normal of a triangle, or zero for a degenerate one.
+	glm::vec3 triangleNormal(const Vertex3D* vertices, const uint32_t* corners) {
+		glm::vec3 a{ position(vertices[corners[0]]) };
+		glm::vec3 normal{ glm::cross(position(vertices[corners[1]]) - a, position(vertices[corners[2]]) - a) };
+		float length{ glm::length(normal) };
+		return length > 0 ? normal / length : glm::vec3{ 0 };
+	}
+
+	// The meshlet made of a submesh's indices [first, last).
+	Meshlet makeMeshlet(const Submesh& submesh, std::span<const uint32_t> faces, const Vertex3D* vertices,
+		size_t first, size_t last) {
+		std::vector<Vertex3D> corners(last - first);
+		glm::vec3 normalSum{ 0 };
+		for (size_t i{ first }; i < last; ++i) {
+			corners[i - first] = vertices[faces[i]];
+		}
+		for (size_t i{ first }; i < last; i += 3) {
+			normalSum += triangleNormal(vertices, &faces[i]);
+		}
+
+		float coneCos{ -1 };
+		glm::vec3 axis{ 0 };
+		if (glm::length(normalSum) > 0) {
+			axis = glm::normalize(normalSum);
+			coneCos = 1;
+			for (size_t i{ first }; i < last; i += 3) {
+				glm::vec3 normal{ triangleNormal(vertices, &faces[i]) };
+				if (normal != glm::vec3{ 0 }) {
+					coneCos = std::min(coneCos, glm::dot(axis, normal));
+				}
+			}
+		}
+		Submesh range{ submesh.indexOffset + static_cast<uint32_t>(first), static_cast<uint32_t>(last - first),
+			submesh.baseVertex };
+		return Meshlet{ range, boundingSphere(corners), axis, coneCos };
+	}
+}
+
+void buildMeshlets(MeshData& mesh) {
+	std::vector<Submesh> submeshes{ submeshesOf(mesh) };
+	std::vector<size_t> vertexCounts{ submeshVertexCounts(mesh, submeshes) };
+	std::vector<std::vector<Meshlet>> meshlets(submeshes.size());
+	parallelFor(submeshes.size(), [&](size_t i) {
+		const Submesh& submesh{ submeshes[i] };
+		std::span<uint32_t> faces{ std::span{ mesh.faces }.subspan(submesh.indexOffset, submesh.indexCount) };
+		const Vertex3D* vertices{ mesh.vertices.data() + submesh.baseVertex };
+		size_t vertexCount{ vertexCounts[i] };
+		uint32_t triangleCount{ static_cast<uint32_t>(faces.size() / 3) };
+
+		// The triangles around each vertex, as ranges of one array.
+		std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+		for (uint32_t index : faces) {
+			++firstTriangle[index + 1];
+		}
+		for (size_t v{ 0 }; v < vertexCount; ++v) {
+			firstTriangle[v + 1] += firstTriangle[v];
+		}
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t f{ 0 }; f < triangleCount * 3; ++f) {
+			adjacency[filled[faces[f]]++] = static_cast<uint32_t>(f / 3);
+		}
+		std::vector<glm::vec3> normals(triangleCount);
+		for (uint32_t t{ 0 }; t < triangleCount; ++t) {
+			normals[t] = triangleNormal(vertices, &faces[t * 3]);
+		}
+
+		// Grows each meshlet from the first triangle not used yet, so meshlets keep roughly the order
+		// the triangles were in, one neighbouring triangle at a time: the one sharing the most
+		// vertices with the meshlet, then the one closest to its average normal.
+		std::vector<uint32_t> order{};
+		order.reserve(triangleCount);
+		// Where each meshlet starts in order.
+		std::vector<size_t> starts{};
+		std::vector<bool> used(triangleCount, false);
+		// Which meshlet (plus one) a vertex is in, or a triangle was made a candidate of.
+		std::vector<uint32_t> vertexMeshlet(vertexCount, 0);
+		std::vector<uint32_t> candidateMeshlet(triangleCount, 0);
+		std::vector<uint32_t> candidates{};
+		uint32_t meshletId{ 0 };
+		uint32_t seed{ 0 };
+		while (order.size() < triangleCount) {
+			while (used[seed]) {
+				++seed;
+			}
+			++meshletId;
+			size_t first{ order.size() };
+			starts.push_back(first);
+			glm::vec3 normalSum{ 0 };
+			candidates.clear();
+			uint32_t next{ seed };
+			while (true) {
+				used[next] = true;
+				order.push_back(next);
+				normalSum += normals[next];
+				for (size_t k{ 0 }; k < 3; ++k) {
+					uint32_t v{ faces[next * 3 + k] };
+					vertexMeshlet[v] = meshletId;
+					for (uint32_t a{ firstTriangle[v] }; a < firstTriangle[v + 1]; ++a) {
+						uint32_t neighbour{ adjacency[a] };
+						if (!used[neighbour] && candidateMeshlet[neighbour] != meshletId) {
+							candidateMeshlet[neighbour] = meshletId;
+							candidates.push_back(neighbour);
+						}
+					}
+				}
+				size_t triangles{ order.size() - first };
+				if (triangles >= MESHLET_MAX_TRIANGLES) {
+					break;
+				}
+
+				float sumLength{ glm::length(normalSum) };
+				glm::vec3 axis{ sumLength > 0 ? normalSum / sumLength : glm::vec3{ 0 } };
+				float bestScore{ -1e30f };
+				size_t best{ SIZE_MAX };
+				for (size_t c{ 0 }; c < candidates.size(); ++c) {
+					uint32_t candidate{ candidates[c] };
+					if (used[candidate]) {
+						candidates[c--] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+					int shared{ 0 };
+					for (size_t k{ 0 }; k < 3; ++k) {
+						shared += vertexMeshlet[faces[candidate * 3 + k]] == meshletId;
+					}
+					float score{ 2.0f * shared + glm::dot(axis, normals[candidate]) };
+					if (score > bestScore) {
+						bestScore = score;
+						best = c;
+					}
+				}
+				if (best == SIZE_MAX) {
+					break;
+				}
+				next = candidates[best];
+				if (triangles >= MESHLET_MIN_TRIANGLES && sumLength > 0
+					&& glm::dot(axis, normals[next]) < MESHLET_SPLIT_COS) {
+					break;
+				}
+			}
+		}
+
+		std::vector<uint32_t> reordered(faces.size());
+		for (size_t t{ 0 }; t < order.size(); ++t) {
+			std::copy_n(&faces[order[t] * 3], 3, &reordered[t * 3]);
+		}
+		std::copy(reordered.begin(), reordered.end(), faces.begin());
+		starts.push_back(order.size());
+
+		// Growing meshlets undoes optimizeMesh's order for the vertex cache, so each meshlet is put
+		// back in that order on its own, numbering its vertices locally to keep that cheap.
+		std::vector<uint32_t> local{};
+		std::vector<uint32_t> global{};
+		std::fill(vertexMeshlet.begin(), vertexMeshlet.end(), 0);
+		for (size_t m{ 0 }; m + 1 < starts.size(); ++m) {
+			std::span<uint32_t> part{ faces.subspan(starts[m] * 3, (starts[m + 1] - starts[m]) * 3) };
+			local.resize(part.size());
+			global.clear();
+			for (size_t f{ 0 }; f < part.size(); ++f) {
+				uint32_t& slot{ vertexMeshlet[part[f]] };
+				if (slot == 0) {
+					global.push_back(part[f]);
+					slot = static_cast<uint32_t>(global.size());
+				}
+				local[f] = slot - 1;
+			}
+			std::vector<uint32_t> optimized{ optimizeVertexCache(local, global.size()) };
+			for (size_t f{ 0 }; f < part.size(); ++f) {
+				part[f] = global[optimized[f]];
+			}
+			for (uint32_t v : global) {
+				vertexMeshlet[v] = 0;
+			}
+			meshlets[i].push_back(makeMeshlet(submesh, faces, vertices, starts[m] * 3, starts[m + 1] * 3));
+		}
+	});
+
+	mesh.meshlets.clear();
+	for (const std::vector<Meshlet>& part : meshlets) {
+		mesh.meshlets.insert(mesh.meshlets.end(), part.begin(), part.end());
+	}
+}
+
+MeshletCullStats cullMeshlets(const Mesh& mesh, const glm::mat4& modelView, const glm::mat4& projection,
+	std::vector<Submesh>& visible) {
+	MeshletCullStats stats{};
+	visible.clear();
+
+	// The largest scale along any axis, so spheres stay around their meshlets.
+	float scale{ std::sqrt(std::max({ glm::dot(glm::vec3{ modelView[0] }, glm::vec3{ modelView[0] }),
+		glm::dot(glm::vec3{ modelView[1] }, glm::vec3{ modelView[1] }),
+		glm::dot(glm::vec3{ modelView[2] }, glm::vec3{ modelView[2] })
+	})) };
+	glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ modelView })) };
+
+	// The frustum's planes in view space, from the rows of the projection (Gribb and Hartmann),
+	// facing inwards.
+	glm::mat4 rows{ glm::transpose(projection) };
+	std::array<glm::vec4, 6> planes{
+		rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3{ plane });
+	}
+
+	for (const Meshlet& meshlet : mesh.meshlets) {
+		glm::vec3 center{ modelView * glm::vec4{ meshlet.bounds.center, 1 } };
+		float radius{ meshlet.bounds.radius * scale };
+		bool outside{ std::any_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+			return glm::dot(glm::vec3{ plane }, center) + plane.w < -radius;
+		}) };
+		if (outside) {
+			++stats.outsideFrustum;
+			continue;
+		}
+
+		// The camera is at the origin. Every triangle faces away if the angle between the cone's axis
+		// and the direction to the sphere, plus the cone's half-angle, leaves every point of the
+		// sphere less than 90 degrees from every normal.
+		float distance{ glm::length(center) };
+		if (meshlet.coneCos > 0 && distance > radius) {
+			glm::vec3 axis{ glm::normalize(normalMatrix * meshlet.coneAxis) };
+			float viewCos{ glm::dot(axis, center) / distance };
+			float viewSin{ std::sqrt(std::max(1 - viewCos * viewCos, 0.0f)) };
+			float coneSin{ std::sqrt(std::max(1 - meshlet.coneCos * meshlet.coneCos, 0.0f)) };
+			if (viewCos * meshlet.coneCos - viewSin * coneSin > radius / distance) {
+				++stats.facingAway;
+				continue;
+			}
+		}
+
+		const Submesh& range{ meshlet.range };
+		stats.indices += range.indexCount;
+		if (!visible.empty() && visible.back().baseVertex == range.baseVertex
+			&& visible.back().indexOffset + visible.back().indexCount == range.indexOffset) {
+			visible.back().indexCount += range.indexCount;
+		}
+		else {
+			visible.push_back(range);
+		}
+	}
+	return stats;
+}
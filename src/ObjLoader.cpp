@@ -0,0 +1,344 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_LOADER_SSE2
+#endif
+
+namespace {
+	// Files smaller than this are not worth splitting across threads.
+	const size_t MIN_CHUNK_SIZE{ 1 << 20 };
+
+	// The vertices and triangles of one chunk of the file. Indices are already 0-based and global,
+	// except for relative (negative) ones, which are only known relative to the chunk's first
+	// vertex until the chunks before it have been counted.
+	struct ObjChunk {
+		const char* begin;
+		const char* end;
+		std::vector<Vertex3D> vertices;
+		std::vector<uint32_t> faces;
+		// (position in faces, index relative to this chunk's first vertex)
+		std::vector<std::pair<size_t, int64_t>> relativeIndices;
+		std::exception_ptr error;
+	};
+
+	// One corner of a polygon, as written in the file.
+	struct ObjIndex {
+		int64_t index;
+		bool relative;
+	};
+
+	// Finds the next '\n', 16 bytes at a time where SSE2 is available.
+	const char* findNewline(const char* p, const char* end) {
+#ifdef OBJ_LOADER_SSE2
+		const __m128i newline{ _mm_set1_epi8('\n') };
+		while (end - p >= 16) {
+			__m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+			int mask{ _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)) };
+			if (mask != 0) {
+				return p + std::countr_zero(static_cast<uint32_t>(mask));
+			}
+			p += 16;
+		}
+#endif
+		while (p < end && *p != '\n') {
+			++p;
+		}
+		return p;
+	}
+
+	bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	// Tokens on a line are short, so whitespace is skipped a byte at a time.
+	const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	const char* skipToken(const char* p, const char* end) {
+		while (p < end && !isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	class ObjChunkParser {
+		ObjChunk& m_chunk;
+		const char* m_fileStart;
+		const std::string& m_path;
+		std::vector<ObjIndex> m_polygon;
+
+		[[noreturn]] void fail(const char* at, const char* what) const {
+			throw std::runtime_error(m_path + ": " + what + " at byte " + std::to_string(at - m_fileStart));
+		}
+
+		void parseVertex(const char* p, const char* end) {
+			float position[3];
+			for (float& component : position) {
+				p = skipSpaces(p, end);
+				if (p < end && *p == '+') {
+					++p;
+				}
+				auto [next, error] { std::from_chars(p, end, component) };
+				if (error != std::errc{}) {
+					fail(p, "malformed vertex");
+				}
+				p = next;
+			}
+			m_chunk.vertices.push_back(Vertex3D{ position[0], position[1], position[2] });
+		}
+
+		void parseFace(const char* p, const char* end) {
+			m_polygon.clear();
+			while ((p = skipSpaces(p, end)) < end) {
+				int64_t index{ 0 };
+				auto [next, error] { std::from_chars(p, end, index) };
+				if (error != std::errc{} || index == 0 || index > UINT32_MAX) {
+					fail(p, "malformed face");
+				}
+				// Relative indices count back from the last vertex read so far: -1 is the latest.
+				m_polygon.push_back(index < 0
+					? ObjIndex{ static_cast<int64_t>(m_chunk.vertices.size()) + index, true }
+					: ObjIndex{ index - 1, false });
+				// Skip the texture coordinate and normal indices, if any.
+				p = skipToken(next, end);
+			}
+			if (m_polygon.size() < 3) {
+				fail(end, "face with fewer than 3 vertices");
+			}
+			for (size_t i{ 2 }; i < m_polygon.size(); ++i) {
+				for (const ObjIndex& corner : { m_polygon[0], m_polygon[i - 1], m_polygon[i] }) {
+					if (corner.relative) {
+						m_chunk.relativeIndices.emplace_back(m_chunk.faces.size(), corner.index);
+						m_chunk.faces.push_back(0);
+					}
+					else {
+						m_chunk.faces.push_back(static_cast<uint32_t>(corner.index));
+					}
+				}
+			}
+		}
+
+	public:
+		ObjChunkParser(ObjChunk& chunk, const char* fileStart, const std::string& path)
+			: m_chunk(chunk), m_fileStart(fileStart), m_path(path), m_polygon{} {
+		}
+
+		void parse() {
+			const char* p{ m_chunk.begin };
+			while (p < m_chunk.end) {
+				const char* lineEnd{ findNewline(p, m_chunk.end) };
+				const char* line{ skipSpaces(p, lineEnd) };
+				if (lineEnd - line >= 2 && isSpace(line[1])) {
+					if (line[0] == 'v') {
+						parseVertex(line + 2, lineEnd);
+					}
+					else if (line[0] == 'f') {
+						parseFace(line + 2, lineEnd);
+					}
+				}
+				p = lineEnd + 1;
+			}
+		}
+	};
+
+	// Splits the text into roughly equal chunks, each ending just after a newline.
+	std::vector<ObjChunk> splitChunks(std::string_view text) {
+		size_t threads{ std::max(1u, std::thread::hardware_concurrency()) };
+		size_t count{ std::clamp<size_t>(text.size() / MIN_CHUNK_SIZE, 1, threads) };
+		std::vector<ObjChunk> chunks(count);
+		const char* begin{ text.data() };
+		const char* end{ text.data() + text.size() };
+		for (size_t i{ 0 }; i < count; ++i) {
+			const char* chunkEnd{ end };
+			if (i + 1 < count) {
+				chunkEnd = findNewline(text.data() + text.size() * (i + 1) / count, end);
+				chunkEnd = std::min(chunkEnd + 1, end);
+			}
+			chunks[i].begin = begin;
+			chunks[i].end = std::max(begin, chunkEnd);
+			begin = chunks[i].end;
+		}
+		return chunks;
+	}
+
+	// Counts what ObjChunkParser would read from a chunk, without parsing any numbers.
+	ObjCounts countChunk(const ObjChunk& chunk) {
+		ObjCounts counts{};
+		const char* p{ chunk.begin };
+		while (p < chunk.end) {
+			const char* lineEnd{ findNewline(p, chunk.end) };
+			const char* line{ skipSpaces(p, lineEnd) };
+			if (lineEnd - line >= 2 && isSpace(line[1])) {
+				if (line[0] == 'v') {
+					++counts.vertices;
+				}
+				else if (line[0] == 'f') {
+					size_t corners{ 0 };
+					for (const char* corner{ skipSpaces(line + 2, lineEnd) }; corner < lineEnd;
+						corner = skipSpaces(skipToken(corner, lineEnd), lineEnd)) {
+						++corners;
+					}
+					// Polygons are triangulated as fans.
+					counts.faces += corners >= 3 ? (corners - 2) * 3 : 0;
+				}
+			}
+			p = lineEnd + 1;
+		}
+		return counts;
+	}
+
+	// Runs work(i) for every chunk, on its own thread when there is more than one, and rethrows the
+	// first error any of them hit.
+	template <typename Work>
+	void forEachChunk(std::vector<ObjChunk>& chunks, Work work) {
+		auto run{ [&](size_t i) {
+			try {
+				work(i);
+			}
+			catch (...) {
+				chunks[i].error = std::current_exception();
+			}
+		} };
+		if (chunks.size() == 1) {
+			run(0);
+		}
+		else {
+			std::vector<std::jthread> threads;
+			threads.reserve(chunks.size());
+			for (size_t i{ 0 }; i < chunks.size(); ++i) {
+				threads.emplace_back(run, i);
+			}
+		}
+		for (const ObjChunk& chunk : chunks) {
+			if (chunk.error) {
+				std::rethrow_exception(chunk.error);
+			}
+		}
+	}
+
+	// Lays parsed chunks out one after another, after whatever the lists already held. The file's
+	// first vertex is index firstIndex, and the chunks' first vertex is the file's vertex
+	// firstVertex; every index must be below vertexLimit once firstIndex is added.
+	void appendChunks(std::vector<ObjChunk>& chunks, const std::string& path, size_t firstIndex, size_t firstVertex,
+		size_t vertexLimit, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+		std::vector<size_t> vertexStarts(chunks.size());
+		std::vector<size_t> faceStarts(chunks.size());
+		size_t vertexCount{ vertices.size() };
+		size_t faceCount{ faces.size() };
+		for (size_t i{ 0 }; i < chunks.size(); ++i) {
+			vertexStarts[i] = vertexCount;
+			faceStarts[i] = faceCount;
+			vertexCount += chunks[i].vertices.size();
+			faceCount += chunks[i].faces.size();
+		}
+		// The index of the first vertex the lists already held.
+		int64_t indexShift{ static_cast<int64_t>(firstIndex + firstVertex) - static_cast<int64_t>(vertices.size()) };
+		vertices.resize(vertexCount);
+		faces.resize(faceCount);
+
+		forEachChunk(chunks, [&](size_t i) {
+			ObjChunk& chunk{ chunks[i] };
+			std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vertexStarts[i]);
+			uint32_t* chunkFaces{ faces.data() + faceStarts[i] };
+			for (size_t f{ 0 }; f < chunk.faces.size(); ++f) {
+				chunkFaces[f] = static_cast<uint32_t>(chunk.faces[f] + firstIndex);
+			}
+			for (const auto& [position, relative] : chunk.relativeIndices) {
+				int64_t index{ static_cast<int64_t>(vertexStarts[i]) + indexShift + relative };
+				if (index < static_cast<int64_t>(firstIndex)) {
+					throw std::runtime_error(path + ": relative face index before the first vertex");
+				}
+				chunkFaces[position] = static_cast<uint32_t>(index);
+			}
+			for (size_t f{ 0 }; f < chunk.faces.size(); ++f) {
+				if (chunkFaces[f] >= vertexLimit) {
+					throw std::runtime_error(path + ": face index " + std::to_string(chunkFaces[f] - firstIndex + 1)
+						+ " is past the last vertex");
+				}
+			}
+		});
+	}
+}
+
+void loadObj(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+	MappedFile file{ path };
+	std::string_view text{ file.text() };
+	std::vector<ObjChunk> chunks{ splitChunks(text) };
+
+	forEachChunk(chunks, [&](size_t i) {
+		ObjChunkParser{ chunks[i], text.data(), path }.parse();
+	});
+
+	size_t vertexCount{ vertices.size() };
+	for (const ObjChunk& chunk : chunks) {
+		vertexCount += chunk.vertices.size();
+	}
+	if (vertexCount > UINT32_MAX) {
+		throw std::runtime_error(path + ": too many vertices for 32-bit indices");
+	}
+	appendChunks(chunks, path, vertices.size(), 0, vertexCount, vertices, faces);
+}
+
+void streamObj(const std::string& path, size_t windowSize, const ObjSizeCallback& sized,
+	const ObjChunkCallback& chunk) {
+	MappedFile file{ path };
+	std::string_view text{ file.text() };
+	// Splits each window of the file into chunks for work, then lets its pages go.
+	auto forEachWindow{ [&](auto work) {
+		const char* begin{ text.data() };
+		const char* end{ text.data() + text.size() };
+		while (begin < end) {
+			const char* windowEnd{ end };
+			if (static_cast<size_t>(end - begin) > windowSize) {
+				windowEnd = std::min(findNewline(begin + windowSize, end) + 1, end);
+			}
+			std::vector<ObjChunk> chunks{ splitChunks(std::string_view{ begin, static_cast<size_t>(windowEnd - begin) }) };
+			work(chunks);
+			file.release(std::as_bytes(std::span{ begin, windowEnd }));
+			begin = windowEnd;
+		}
+	} };
+
+	ObjCounts total{};
+	forEachWindow([&](std::vector<ObjChunk>& chunks) {
+		std::vector<ObjCounts> counts(chunks.size());
+		forEachChunk(chunks, [&](size_t i) {
+			counts[i] = countChunk(chunks[i]);
+		});
+		for (const ObjCounts& count : counts) {
+			total.vertices += count.vertices;
+			total.faces += count.faces;
+		}
+	});
+	if (total.vertices > UINT32_MAX) {
+		throw std::runtime_error(path + ": too many vertices for 32-bit indices");
+	}
+	sized(total);
+
+	std::vector<Vertex3D> vertices{};
+	std::vector<uint32_t> faces{};
+	size_t vertexCount{ 0 };
+	forEachWindow([&](std::vector<ObjChunk>& chunks) {
+		forEachChunk(chunks, [&](size_t i) {
+			ObjChunkParser{ chunks[i], text.data(), path }.parse();
+		});
+		vertices.clear();
+		faces.clear();
+		appendChunks(chunks, path, 0, vertexCount, total.vertices, vertices, faces);
+		vertexCount += vertices.size();
+		chunk(vertices, faces);
+	});
+}
@@ -0,0 +1,78 @@
+#include "ProgramPipeline.h"
+#include <glad/glad.h>
+#include <stdexcept>
+
+namespace {
+	size_t stageIndex(ShaderStage stage) {
+		return stage == ShaderStage::Vertex ? 0 : 1;
+	}
+}
+
+ProgramPipeline::ProgramPipeline()
+	: m_pipeline{}, m_stages{} {
+	if (!ShaderProgram::separableSupported()) {
+		throw std::runtime_error("Program pipelines need GL 4.1 or ARB_separate_shader_objects");
+	}
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	uint32_t pipeline{ 0 };
+	glGenProgramPipelines(1, &pipeline);
+	m_pipeline = GlProgramPipeline{ pipeline };
+#endif
+}
+
+void ProgramPipeline::useStage(ShaderProgram& program) {
+	program.finishLoad();
+	if (!program.separableStage()) {
+		throw std::runtime_error("Only separable programs can be used in a program pipeline");
+	}
+	ShaderStage stage{ *program.separableStage() };
+	m_stages[stageIndex(stage)].program = &program;
+	attach(stage);
+}
+
+ShaderProgram* ProgramPipeline::stage(ShaderStage stage) const {
+	return m_stages[stageIndex(stage)].program;
+}
+
+// Points the pipeline's stage at its program's current GL program, unless it already is.
+void ProgramPipeline::attach(ShaderStage stage) {
+	AttachedStage& attached{ m_stages[stageIndex(stage)] };
+	if (!attached.program) {
+		return;
+	}
+	attached.program->finishLoad();
+	if (attached.generation == attached.program->m_generation) {
+		return;
+	}
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	glUseProgramStages(m_pipeline.get(),
+		stage == ShaderStage::Vertex ? GL_VERTEX_SHADER_BIT : GL_FRAGMENT_SHADER_BIT,
+		attached.program->m_program.get());
+#endif
+	attached.generation = attached.program->m_generation;
+}
+
+void ProgramPipeline::activate() {
+	attach(ShaderStage::Vertex);
+	attach(ShaderStage::Fragment);
+	// A program made current with glUseProgram takes precedence over the bound pipeline.
+	glUseProgram(0);
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	glBindProgramPipeline(m_pipeline.get());
+#endif
+}
+
+void ProgramPipeline::validate() {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	attach(ShaderStage::Vertex);
+	attach(ShaderStage::Fragment);
+	glValidateProgramPipeline(m_pipeline.get());
+	int32_t valid{ 0 };
+	glGetProgramPipelineiv(m_pipeline.get(), GL_VALIDATE_STATUS, &valid);
+	if (!valid) {
+		char infoLog[512]{};
+		glGetProgramPipelineInfoLog(m_pipeline.get(), 512, NULL, infoLog);
+		throw std::runtime_error(infoLog);
+	}
+#endif
+}
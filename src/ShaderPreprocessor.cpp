@@ -0,0 +1,141 @@
+#include "ShaderPreprocessor.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+	std::string_view trimStart(std::string_view line) {
+		size_t start{ line.find_first_not_of(" \t") };
+		return start == std::string_view::npos ? std::string_view{} : line.substr(start);
+	}
+
+	// If the line is a preprocessor directive with the given name, returns the rest of the line.
+	std::optional<std::string_view> directive(std::string_view line, std::string_view name) {
+		line = trimStart(line);
+		if (!line.starts_with('#')) {
+			return std::nullopt;
+		}
+		line = trimStart(line.substr(1));
+		if (!line.starts_with(name)) {
+			return std::nullopt;
+		}
+		std::string_view rest{ line.substr(name.size()) };
+		if (!rest.empty() && rest[0] != ' ' && rest[0] != '\t') {
+			return std::nullopt;
+		}
+		return trimStart(rest);
+	}
+
+	class Preprocessor {
+		const ShaderFileReader& m_readFile;
+		std::vector<std::string>& m_files;
+		std::string& m_output;
+
+	public:
+		Preprocessor(const ShaderFileReader& readFile, std::vector<std::string>& files, std::string& output)
+			: m_readFile(readFile), m_files(files), m_output(output) {
+		}
+
+		void process(const std::string& path, const ShaderDefines* defines) {
+			std::optional<std::string> source{ m_readFile(path) };
+			if (!source) {
+				throw std::runtime_error("Failed to locate shader file " + path);
+			}
+			auto fileIndex{ m_files.size() };
+			m_files.push_back(path);
+
+			// Defines go right after the #version line, which has to come before anything but comments,
+			// or at the very top of a source without one.
+			if (defines && !hasVersion(*source)) {
+				define(*defines, 0, fileIndex);
+			}
+
+			std::istringstream lines{ *source };
+			std::string line;
+			size_t lineNumber{ 0 };
+			while (std::getline(lines, line)) {
+				++lineNumber;
+				if (!line.empty() && line.back() == '\r') {
+					line.pop_back();
+				}
+
+				if (auto include{ directive(line, "include") }) {
+					std::string includePath{ resolveInclude(path, *include, lineNumber) };
+					if (std::find(m_files.begin(), m_files.end(), includePath) == m_files.end()) {
+						m_output += "#line 1 " + std::to_string(m_files.size()) + "\n";
+						process(includePath, nullptr);
+						m_output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+					}
+					else {
+						m_output += "\n";
+					}
+					continue;
+				}
+				if (auto extension{ directive(line, "extension") };
+					extension && extension->starts_with("GL_GOOGLE_include_directive")) {
+					// Only there so offline compilers accept the #includes we resolve ourselves.
+					m_output += "\n";
+					continue;
+				}
+				if (directive(line, "pragma").value_or("") == "once") {
+					m_output += "\n";
+					continue;
+				}
+
+				m_output += line;
+				m_output += '\n';
+				if (defines && directive(line, "version")) {
+					define(*defines, lineNumber, fileIndex);
+				}
+			}
+		}
+
+	private:
+		// Writes the defines, then resets the line number to the one after lineNumber.
+		void define(const ShaderDefines& defines, size_t lineNumber, size_t fileIndex) {
+			for (const auto& [name, value] : defines) {
+				m_output += "#define " + name + " " + value + "\n";
+			}
+			m_output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+
+		static bool hasVersion(const std::string& source) {
+			std::istringstream lines{ source };
+			std::string line;
+			while (std::getline(lines, line)) {
+				if (directive(line, "version")) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static std::string resolveInclude(const std::string& includer, std::string_view argument, size_t lineNumber) {
+			if (argument.size() < 2 || argument.front() != '"' || argument.find('"', 1) == std::string_view::npos) {
+				throw std::runtime_error(includer + ":" + std::to_string(lineNumber) + ": malformed #include");
+			}
+			std::string_view name{ argument.substr(1, argument.find('"', 1) - 1) };
+			return (std::filesystem::path{ includer }.parent_path() / name).lexically_normal().generic_string();
+		}
+	};
+}
+
+std::optional<std::string> readShaderFile(const std::string& path) {
+	std::ifstream file{ path, std::ios::binary };
+	if (!file) {
+		return std::nullopt;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	return stream.str();
+}
+
+PreprocessedShader preprocessShader(const std::string& path, const ShaderDefines& defines,
+	const ShaderFileReader& readFile) {
+	PreprocessedShader shader{};
+	Preprocessor{ readFile, shader.files, shader.source }.process(path, &defines);
+	return shader;
+}
@@ -1,123 +1,978 @@
 #include "ShaderProgram.h"
+#include "EmbeddedShaders.h"
+#include "SpirvReflection.h"
+#include "UniformBuffer.h"
 #include <glad/glad.h>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
 
-ShaderProgram::ShaderProgram()
-	: m_programId(-1) {
-}
-
-void ShaderProgram::load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath) {
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		// open files
-		vShaderFile.open(vertexShaderPath);
-		fShaderFile.open(fragmentShaderPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure& e) {
-		throw std::runtime_error("Failed to locate vertex or fragment shader files");
-	}
-
-	const char* vShaderCode{ vertexCode.c_str() };
-	const char* fShaderCode{ fragmentCode.c_str() };
-
-	unsigned int vertex, fragment;
-	int success;
-	char infoLog[512];
+namespace {
+	std::atomic<uint32_t> nextGeneration{ 1 };
 
-	// vertex Shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-	// print compile errors if any
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		throw std::runtime_error(infoLog);
-	};
+	UniformType uniformTypeFromGl(GLenum type) {
+		switch (type) {
+		case GL_BOOL: return UniformType::Bool;
+		case GL_INT: return UniformType::Int;
+		case GL_FLOAT: return UniformType::Float;
+		case GL_FLOAT_VEC2: return UniformType::Vec2;
+		case GL_FLOAT_VEC3: return UniformType::Vec3;
+		case GL_FLOAT_VEC4: return UniformType::Vec4;
+		case GL_FLOAT_MAT2: return UniformType::Mat2;
+		case GL_FLOAT_MAT3: return UniformType::Mat3;
+		case GL_FLOAT_MAT4: return UniformType::Mat4;
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_SHADOW:
+			return UniformType::Sampler;
+		default: return UniformType::Unknown;
+		}
+	}
 
-	// similiar for Fragment Shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
-	// print compile errors if any
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		throw std::runtime_error(infoLog);
+	const char* uniformTypeName(UniformType type) {
+		switch (type) {
+		case UniformType::Bool: return "bool";
+		case UniformType::Int: return "int";
+		case UniformType::Float: return "float";
+		case UniformType::Vec2: return "vec2";
+		case UniformType::Vec3: return "vec3";
+		case UniformType::Vec4: return "vec4";
+		case UniformType::Mat2: return "mat2";
+		case UniformType::Mat3: return "mat3";
+		case UniformType::Mat4: return "mat4";
+		case UniformType::Sampler: return "sampler";
+		default: return "unknown";
+		}
+	}
+
+	// Compiled programs are cached in this directory, relative to the working directory like the
+	// shaders directory itself.
+	const std::filesystem::path PROGRAM_CACHE_DIRECTORY{ "shadercache" };
+	const uint32_t PROGRAM_CACHE_MAGIC{ 0x43505053 }; // "SPPC"
+
+	// Precedes the driver's binary blob in each cache file.
+	struct ProgramCacheHeader {
+		uint32_t magic;
+		uint32_t format;
+		uint64_t key;
 	};
 
+	std::string_view glString(GLenum name) {
+		auto value{ reinterpret_cast<const char*>(glGetString(name)) };
+		return value ? value : "";
+	}
+
+	// Whether the context can hand us linked program binaries. Needs GL 4.1 or
+	// ARB_get_program_binary, and at least one binary format exposed by the driver.
+	bool programBinarySupported() {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+		static const bool supported{ [] {
+			bool available{ false };
+#ifdef GL_VERSION_4_1
+			available = available || GLAD_GL_VERSION_4_1;
+#endif
+#ifdef GL_ARB_get_program_binary
+			available = available || GLAD_GL_ARB_get_program_binary;
+#endif
+			int32_t formats{ 0 };
+			if (available) {
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			}
+			return formats > 0;
+		}() };
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	// The binary a driver produces is only valid for that driver, so the key covers both the
+	// sources and the driver's identity.
+	uint64_t programCacheKey(const std::string& vertexCode, const std::string& fragmentCode) {
+		uint64_t key{ fnv1a(vertexCode) };
+		// Separators keep ("ab", "c") and ("a", "bc") from producing the same key.
+		key = fnv1a(std::string_view{ "\0", 1 }, key);
+		key = fnv1a(fragmentCode, key);
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			key = fnv1a(std::string_view{ "\0", 1 }, key);
+			key = fnv1a(glString(name), key);
+		}
+		return key;
+	}
+
+	std::filesystem::path programCachePath(uint64_t key) {
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+		return PROGRAM_CACHE_DIRECTORY / name.str();
+	}
+
+	// Tries to initialize the given program from a cached binary. Returns false if there is no
+	// cache entry, or the driver rejects it (e.g. after a driver update).
+	bool loadProgramBinary(uint32_t program, uint64_t key) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+		if (!programBinarySupported()) {
+			return false;
+		}
+		auto path{ programCachePath(key) };
+		std::ifstream file{ path, std::ios::binary };
+		if (!file) {
+			return false;
+		}
+
+		ProgramCacheHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		std::vector<char> binary{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+		file.close();
+		if (header.magic != PROGRAM_CACHE_MAGIC || header.key != key || binary.empty()) {
+			return false;
+		}
+
+		glProgramBinary(program, header.format, binary.data(), static_cast<int32_t>(binary.size()));
+		int32_t success{ 0 };
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			// Stale or corrupt; it will be replaced after the source compile.
+			std::error_code ignored;
+			std::filesystem::remove(path, ignored);
+		}
+		return success;
+#else
+		return false;
+#endif
+	}
+
+	// Writes the binary of a freshly linked program to the cache. Failing to write is not an error;
+	// the program will just be compiled from source again next time.
+	void storeProgramBinary(uint32_t program, uint64_t key) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+		if (!programBinarySupported()) {
+			return;
+		}
+		int32_t length{ 0 };
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+
+		ProgramCacheHeader header{ PROGRAM_CACHE_MAGIC, 0, key };
+		std::vector<char> binary(length);
+		glGetProgramBinary(program, length, &length, &header.format, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(PROGRAM_CACHE_DIRECTORY, error);
+		std::ofstream file{ programCachePath(key), std::ios::binary | std::ios::trunc };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), length);
+#endif
+	}
+
+	GLenum glShaderStage(ShaderStage stage) {
+		return stage == ShaderStage::Vertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+	}
+
+	// Asks the driver to use as many compiler threads as it likes, if it supports
+	// KHR/ARB_parallel_shader_compile. Returns whether completion status can be polled.
+	bool enableParallelShaderCompile() {
+		static const bool supported{ [] {
+#ifdef GL_KHR_parallel_shader_compile
+			if (GLAD_GL_KHR_parallel_shader_compile) {
+				glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+				return true;
+			}
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+			if (GLAD_GL_ARB_parallel_shader_compile) {
+				glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+				return true;
+			}
+#endif
+			return false;
+		}() };
+		return supported;
+	}
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	// The separable parts of ShaderProgram need GL 4.1 or ARB_separate_shader_objects.
+	bool separateShaderObjectsSupported() {
+		bool available{ false };
+#ifdef GL_VERSION_4_1
+		available = available || GLAD_GL_VERSION_4_1;
+#endif
+#ifdef GL_ARB_separate_shader_objects
+		available = available || GLAD_GL_ARB_separate_shader_objects;
+#endif
+		return available;
+	}
+#endif
+
+	// Whether a value of type `given` may be written to a uniform declared as `declared`.
+	bool uniformTypeCompatible(UniformType declared, UniformType given) {
+		return declared == given
+			|| declared == UniformType::Unknown
+			|| (declared == UniformType::Sampler && given == UniformType::Int)
+			|| (declared == UniformType::Bool && given == UniformType::Int);
+	}
+}
+
+ShaderProgram::ShaderProgram()
+	: m_program{}, m_generation(0), m_uniforms{}, m_uniformIndex{}, m_uniformHashes{},
+	m_uniformStats{}, m_loadReport{}, m_uniformBlocks{}, m_declaredUniforms{}, m_separableStage{},
+	m_binaryKey(NO_BINARY_CACHE), m_pendingLink{} {
+}
+
+void ShaderProgram::load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+	const ShaderDefines& defines) {
+	loadAsync(vertexShaderPath, fragmentShaderPath, defines);
+	finishLoad();
+}
+
+// Reads and preprocesses both shader sources, then submits their compile and link to the driver
+// without waiting for either to finish. The result is checked by finishLoad, which every function
+// that needs the linked program calls implicitly.
+void ShaderProgram::loadAsync(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+	const ShaderDefines& defines) {
+	PreprocessedShader vertex{ preprocessShader(vertexShaderPath, defines) };
+	PreprocessedShader fragment{ preprocessShader(fragmentShaderPath, defines) };
+	loadSourceAsync(vertex.source, fragment.source);
+}
+
+void ShaderProgram::loadEmbedded(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+	const ShaderDefines& defines) {
+	loadEmbeddedAsync(vertexShaderName, fragmentShaderName, defines);
+	finishLoad();
+}
+
+// As loadAsync, but reads the shaders (and their includes) from the copies compiled into the
+// executable, by their path relative to shaders_source/.
+void ShaderProgram::loadEmbeddedAsync(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+	const ShaderDefines& defines) {
+	PreprocessedShader vertex{ preprocessShader(vertexShaderName, defines, readEmbeddedShader) };
+	PreprocessedShader fragment{ preprocessShader(fragmentShaderName, defines, readEmbeddedShader) };
+	loadSourceAsync(vertex.source, fragment.source);
+}
+
+// As loadAsync, but with the final (already preprocessed) GLSL sources in memory.
+void ShaderProgram::loadSourceAsync(const std::string& vertexCode, const std::string& fragmentCode) {
+	m_declaredUniforms.clear();
+	uint64_t cacheKey{ binaryCacheKey(vertexCode, fragmentCode) };
+	if (loadBinary(cacheKey)) {
+		return;
+	}
+	GlShader vertex{ compileShaderAsync(ShaderStage::Vertex, vertexCode) };
+	GlShader fragment{ compileShaderAsync(ShaderStage::Fragment, fragmentCode) };
+	linkAsync(vertex.get(), fragment.get(), cacheKey);
+	// Keep the shaders alive until the link has been checked.
+	m_pendingLink->ownedVertex = std::move(vertex);
+	m_pendingLink->ownedFragment = std::move(fragment);
+}
+
+// Starts loading every pair of shaders before checking any of them, so the driver can compile
+// them all in parallel (on its own threads, if it supports KHR/ARB_parallel_shader_compile).
+std::vector<ShaderProgram> ShaderProgram::loadAll(const std::vector<ShaderSourcePaths>& sources) {
+	enableParallelShaderCompile();
+	std::vector<ShaderProgram> programs(sources.size());
+	for (size_t i{ 0 }; i < sources.size(); ++i) {
+		programs[i].loadAsync(sources[i].vertexShaderPath, sources[i].fragmentShaderPath, sources[i].defines);
+	}
+	return programs;
+}
+
+uint64_t ShaderProgram::binaryCacheKey(const std::string& vertexCode, const std::string& fragmentCode) {
+	return programCacheKey(vertexCode, fragmentCode);
+}
+
+// Tries to initialize this program from the program binary cache, replacing whatever it held.
+bool ShaderProgram::loadBinary(uint64_t cacheKey) {
+	auto start{ std::chrono::steady_clock::now() };
+	m_pendingLink.reset();
+	createProgram(std::nullopt);
+	m_loadReport.fromBinaryCache = loadProgramBinary(m_program.get(), cacheKey);
+	if (m_loadReport.fromBinaryCache) {
+		m_binaryKey = cacheKey;
+		reflectUniforms();
+	}
+	else {
+		m_program.reset();
+	}
+	m_loadReport.milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	return m_loadReport.fromBinaryCache;
+}
+
+// The key of the program binary this program was loaded from or stored as, or NO_BINARY_CACHE.
+uint64_t ShaderProgram::binaryKey() const {
+	return m_binaryKey;
+}
+
+// Deletes a program binary from the cache, such as one a reloaded program no longer uses.
+void ShaderProgram::discardBinary(uint64_t cacheKey) {
+	if (cacheKey != NO_BINARY_CACHE) {
+		std::error_code ignored;
+		std::filesystem::remove(programCachePath(cacheKey), ignored);
+	}
+}
+
+// Creates a shader object and submits its compile, without waiting for the result.
+GlShader ShaderProgram::compileShaderAsync(ShaderStage stage, const std::string& code) {
+	const char* shaderCode{ code.c_str() };
+	GlShader shader{ glCreateShader(glShaderStage(stage)) };
+	glShaderSource(shader.get(), 1, &shaderCode, NULL);
+	glCompileShader(shader.get());
+	return shader;
+}
+
+// Links the two shaders into a new program, without querying any status. The shaders must stay
+// alive until finishLoad has run; a program binary is stored under cacheKey once it has.
+void ShaderProgram::linkAsync(uint32_t vertexShader, uint32_t fragmentShader, uint64_t cacheKey) {
+	auto start{ std::chrono::steady_clock::now() };
+
 	// shader Program
-	m_programId = glCreateProgram();
-	glAttachShader(m_programId, vertex);
-	glAttachShader(m_programId, fragment);
-	glLinkProgram(m_programId);
-	// print linking errors if any
-	glGetProgramiv(m_programId, GL_LINK_STATUS, &success);
+	createProgram(std::nullopt);
+	glAttachShader(m_program.get(), vertexShader);
+	glAttachShader(m_program.get(), fragmentShader);
+	glLinkProgram(m_program.get());
+
+	m_pendingLink = PendingLink{ vertexShader, fragmentShader, {}, {}, cacheKey };
+	m_loadReport.fromBinaryCache = false;
+	m_loadReport.milliseconds += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+// Replaces the GL program with a new, empty one, with the parameters that must be set before it
+// is linked or loaded from a binary.
+void ShaderProgram::createProgram(std::optional<ShaderStage> separableStage) {
+	m_program = GlProgram{ glCreateProgram() };
+	m_separableStage = separableStage;
+	m_binaryKey = NO_BINARY_CACHE;
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+	if (programBinarySupported()) {
+		glProgramParameteri(m_program.get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+#endif
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	if (separableStage) {
+		glProgramParameteri(m_program.get(), GL_PROGRAM_SEPARABLE, GL_TRUE);
+	}
+#endif
+}
+
+bool ShaderProgram::separableSupported() {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+	return separateShaderObjectsSupported();
+#else
+	return false;
+#endif
+}
+
+// Enables the extension on GLSL versions that predate separable programs, and defines
+// SEPARABLE_PROGRAM, both right after the #version line. Line numbers are left as they were.
+std::string ShaderProgram::separableSource(const std::string& code) {
+	size_t version{ code.find("#version") };
+	if (version == std::string::npos) {
+		throw std::runtime_error("Separable shader has no #version line");
+	}
+	size_t lineEnd{ code.find('\n', version) };
+	if (lineEnd == std::string::npos) {
+		lineEnd = code.size();
+	}
+	int glslVersion{ std::atoi(code.c_str() + version + std::strlen("#version")) };
+	auto lineNumber{ std::count(code.begin(), code.begin() + lineEnd, '\n') + 1 };
+
+	std::string prelude{ "\n" };
+	if (glslVersion < 410) {
+		prelude += "#extension GL_ARB_separate_shader_objects : require\n";
+	}
+	prelude += "#define SEPARABLE_PROGRAM 1\n";
+	prelude += "#line " + std::to_string(lineNumber + 1) + " 0";
+
+	std::string result{ code };
+	result.insert(lineEnd, prelude);
+	return result;
+}
+
+void ShaderProgram::loadStage(ShaderStage stage, const std::string& shaderPath, const ShaderDefines& defines) {
+	loadStageAsync(stage, shaderPath, defines);
+	finishLoad();
+}
+
+void ShaderProgram::loadStageAsync(ShaderStage stage, const std::string& shaderPath, const ShaderDefines& defines) {
+	loadStageSourceAsync(stage, preprocessShader(shaderPath, defines).source);
+}
+
+// As loadSourceAsync, for a single preprocessed stage. The source is passed through
+// separableSource here.
+void ShaderProgram::loadStageSourceAsync(ShaderStage stage, const std::string& code) {
+	m_declaredUniforms.clear();
+	std::string separableCode{ separableSource(code) };
+	uint64_t cacheKey{ stage == ShaderStage::Vertex
+		? binaryCacheKey(separableCode, "")
+		: binaryCacheKey("", separableCode) };
+	if (loadStageBinary(stage, cacheKey)) {
+		return;
+	}
+	GlShader shader{ compileShaderAsync(stage, separableCode) };
+	linkStageAsync(stage, shader.get(), cacheKey);
+	(stage == ShaderStage::Vertex ? m_pendingLink->ownedVertex : m_pendingLink->ownedFragment) = std::move(shader);
+}
+
+bool ShaderProgram::loadStageBinary(ShaderStage stage, uint64_t cacheKey) {
+	if (!separableSupported()) {
+		throw std::runtime_error("Separable shader programs need GL 4.1 or ARB_separate_shader_objects");
+	}
+	auto start{ std::chrono::steady_clock::now() };
+	m_pendingLink.reset();
+	createProgram(stage);
+	m_loadReport.fromBinaryCache = loadProgramBinary(m_program.get(), cacheKey);
+	if (m_loadReport.fromBinaryCache) {
+		m_binaryKey = cacheKey;
+		reflectUniforms();
+	}
+	else {
+		m_program.reset();
+	}
+	m_loadReport.milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	return m_loadReport.fromBinaryCache;
+}
+
+// As linkAsync, for a program containing only the given stage.
+void ShaderProgram::linkStageAsync(ShaderStage stage, uint32_t shader, uint64_t cacheKey) {
+	if (!separableSupported()) {
+		throw std::runtime_error("Separable shader programs need GL 4.1 or ARB_separate_shader_objects");
+	}
+	auto start{ std::chrono::steady_clock::now() };
+	createProgram(stage);
+	glAttachShader(m_program.get(), shader);
+	glLinkProgram(m_program.get());
+
+	m_pendingLink = stage == ShaderStage::Vertex
+		? PendingLink{ shader, 0, {}, {}, cacheKey }
+		: PendingLink{ 0, shader, {}, {}, cacheKey };
+	m_loadReport.fromBinaryCache = false;
+	m_loadReport.milliseconds += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+std::optional<ShaderStage> ShaderProgram::separableStage() const {
+	return m_separableStage;
+}
+
+bool ShaderProgram::spirvSupported() {
+	bool available{ false };
+#ifdef GL_VERSION_4_6
+	available = available || GLAD_GL_VERSION_4_6;
+#endif
+#ifdef GL_ARB_gl_spirv
+	available = available || GLAD_GL_ARB_gl_spirv;
+#endif
+	return available;
+}
+
+std::vector<uint32_t> ShaderProgram::readSpirvModule(const std::string& path) {
+	std::ifstream file{ path, std::ios::binary | std::ios::ate };
+	if (!file) {
+		throw std::runtime_error("Failed to locate SPIR-V module " + path);
+	}
+	auto size{ static_cast<size_t>(file.tellg()) };
+	if (size % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Truncated SPIR-V module " + path);
+	}
+	std::vector<uint32_t> module(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(module.data()), size);
+	return module;
+}
+
+void ShaderProgram::loadSpirv(const std::string& vertexModulePath, const std::string& fragmentModulePath) {
+	loadSpirvAsync(vertexModulePath, fragmentModulePath);
+	finishLoad();
+}
+
+// As loadAsync, but from SPIR-V modules. Their uniforms are reflected from the modules themselves,
+// and the program binary cache is keyed by the module bytes.
+void ShaderProgram::loadSpirvAsync(const std::string& vertexModulePath, const std::string& fragmentModulePath) {
+	if (!spirvSupported()) {
+		throw std::runtime_error("SPIR-V shaders need GL 4.6 or ARB_gl_spirv");
+	}
+	std::vector<uint32_t> vertexModule{ readSpirvModule(vertexModulePath) };
+	std::vector<uint32_t> fragmentModule{ readSpirvModule(fragmentModulePath) };
+	m_declaredUniforms = reflectSpirvUniforms(vertexModule);
+	std::vector<DeclaredUniform> fragmentUniforms{ reflectSpirvUniforms(fragmentModule) };
+	m_declaredUniforms.insert(m_declaredUniforms.end(), fragmentUniforms.begin(), fragmentUniforms.end());
+
+	uint64_t cacheKey{ binaryCacheKey(vertexModule, fragmentModule) };
+	if (loadBinary(cacheKey)) {
+		return;
+	}
+	GlShader vertex{ specializeShaderAsync(ShaderStage::Vertex, vertexModule) };
+	GlShader fragment{ specializeShaderAsync(ShaderStage::Fragment, fragmentModule) };
+	linkAsync(vertex.get(), fragment.get(), cacheKey);
+	m_pendingLink->ownedVertex = std::move(vertex);
+	m_pendingLink->ownedFragment = std::move(fragment);
+}
+
+uint64_t ShaderProgram::binaryCacheKey(std::span<const uint32_t> vertexModule,
+	std::span<const uint32_t> fragmentModule) {
+	auto bytes{ [](std::span<const uint32_t> module) {
+		return std::string{ reinterpret_cast<const char*>(module.data()), module.size_bytes() };
+	} };
+	return programCacheKey(bytes(vertexModule), bytes(fragmentModule));
+}
+
+// As compileShaderAsync, for a SPIR-V module with entry point "main". Specialization fails the
+// same way a compile does, and is reported by finishLoad.
+GlShader ShaderProgram::specializeShaderAsync(ShaderStage stage, std::span<const uint32_t> module) {
+	GlShader shader{ glCreateShader(glShaderStage(stage)) };
+	uint32_t id{ shader.get() };
+#if defined(GL_VERSION_4_6)
+	if (GLAD_GL_VERSION_4_6) {
+		glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V, module.data(),
+			static_cast<GLsizei>(module.size_bytes()));
+		glSpecializeShader(id, "main", 0, nullptr, nullptr);
+		return shader;
+	}
+#endif
+#if defined(GL_ARB_gl_spirv)
+	if (GLAD_GL_ARB_gl_spirv) {
+		glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.data(),
+			static_cast<GLsizei>(module.size_bytes()));
+		glSpecializeShaderARB(id, "main", 0, nullptr, nullptr);
+	}
+#endif
+	return shader;
+}
+
+// Whether finishLoad can run without waiting on the driver. Always true when the driver can't
+// report completion, since then there is no way to know without blocking.
+bool ShaderProgram::isReady() const {
+	if (!m_pendingLink) {
+		return true;
+	}
+#if defined(GL_KHR_parallel_shader_compile) || defined(GL_ARB_parallel_shader_compile)
+	if (enableParallelShaderCompile()) {
+		int32_t complete{ GL_TRUE };
+		glGetProgramiv(m_program.get(), GL_COMPLETION_STATUS_KHR, &complete);
+		return complete;
+	}
+#endif
+	return true;
+}
+
+// Checks the outcome of a compile and link started by loadAsync, throwing with the driver's log
+// if any stage failed, in which case the program is left empty. Blocks if the driver is still
+// working on it.
+void ShaderProgram::finishLoad() {
+	if (!m_pendingLink) {
+		return;
+	}
+	auto start{ std::chrono::steady_clock::now() };
+	PendingLink pending{ std::move(*m_pendingLink) };
+	m_pendingLink.reset();
+
+	int success;
+	char infoLog[512];
+	glGetProgramiv(m_program.get(), GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetProgramInfoLog(m_programId, 512, NULL, infoLog);
+		glGetProgramInfoLog(m_program.get(), 512, NULL, infoLog);
+		// Report a compile error in preference to the link error it caused.
+		for (uint32_t shader : { pending.fragment, pending.vertex }) {
+			if (shader == 0) {
+				continue;
+			}
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success) {
+				glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			}
+		}
+		// Nothing of a failed load is kept: the program, and any shaders it compiled itself, are
+		// deleted before the error reaches the caller. Shaders passed to linkAsync stay with their
+		// owner.
+		m_program.reset();
+		pending.ownedVertex.reset();
+		pending.ownedFragment.reset();
 		throw std::runtime_error(infoLog);
 	}
 
-	// delete the shaders as they're linked into our program now and no longer necessary
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	// Detach the shaders, so they can be deleted as soon as nothing else needs them.
+	for (uint32_t shader : { pending.vertex, pending.fragment }) {
+		if (shader != 0) {
+			glDetachShader(m_program.get(), shader);
+		}
+	}
+
+	if (pending.cacheKey != NO_BINARY_CACHE) {
+		storeProgramBinary(m_program.get(), pending.cacheKey);
+		m_binaryKey = pending.cacheKey;
+	}
+	reflectUniforms();
+
+	m_loadReport.milliseconds += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+// Resolves the location of every active uniform once, so setUniform never has to ask the driver.
+void ShaderProgram::reflectUniforms() {
+	m_generation = nextGeneration++;
+	m_uniforms.clear();
+	m_uniformIndex.clear();
+	m_uniformHashes.clear();
+	m_uniformStats = {};
+	reflectUniformBlocks();
+
+	if (!m_declaredUniforms.empty()) {
+		for (const DeclaredUniform& uniform : m_declaredUniforms) {
+			addUniform(uniform.name, uniform.location, uniform.type);
+		}
+		std::sort(m_uniformHashes.begin(), m_uniformHashes.end());
+		return;
+	}
+
+	int32_t count{ 0 };
+	int32_t maxNameLength{ 0 };
+	glGetProgramiv(m_program.get(), GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program.get(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name(maxNameLength, '\0');
+	for (int32_t i{ 0 }; i < count; ++i) {
+		int32_t length{ 0 };
+		int32_t size{ 0 };
+		GLenum type{ 0 };
+		glGetActiveUniform(m_program.get(), i, maxNameLength, &length, &size, &type, name.data());
+		std::string uniformName{ name.data(), static_cast<size_t>(length) };
+
+		int32_t location{ glGetUniformLocation(m_program.get(), uniformName.c_str()) };
+		if (location < 0) {
+			// Uniforms in a block have no location of their own.
+			continue;
+		}
+		addUniform(std::move(uniformName), location, uniformTypeFromGl(type));
+	}
+	std::sort(m_uniformHashes.begin(), m_uniformHashes.end());
+}
+
+// Records the layout of every uniform block, and binds the shared ones to their binding points.
+// The bindings are program state that isn't part of a program binary, so this runs after every
+// link or binary load.
+void ShaderProgram::reflectUniformBlocks() {
+	m_uniformBlocks.clear();
+	int32_t blockCount{ 0 };
+	glGetProgramiv(m_program.get(), GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	for (int32_t block{ 0 }; block < blockCount; ++block) {
+		auto index{ static_cast<uint32_t>(block) };
+		int32_t nameLength{ 0 };
+		int32_t dataSize{ 0 };
+		int32_t binding{ 0 };
+		int32_t memberCount{ 0 };
+		glGetActiveUniformBlockiv(m_program.get(), index, GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLength);
+		glGetActiveUniformBlockiv(m_program.get(), index, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+		glGetActiveUniformBlockiv(m_program.get(), index, GL_UNIFORM_BLOCK_BINDING, &binding);
+		glGetActiveUniformBlockiv(m_program.get(), index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+
+		std::string blockName(std::max(nameLength, 1), '\0');
+		int32_t length{ 0 };
+		glGetActiveUniformBlockName(m_program.get(), index, nameLength, &length, blockName.data());
+		blockName.resize(length);
+
+		for (const SharedUniformBlock& shared : SHARED_UNIFORM_BLOCKS) {
+			if (shared.name == blockName) {
+				glUniformBlockBinding(m_program.get(), index, shared.binding);
+				binding = static_cast<int32_t>(shared.binding);
+			}
+		}
+
+		std::vector<int32_t> memberIndices(memberCount);
+		glGetActiveUniformBlockiv(m_program.get(), index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, memberIndices.data());
+		std::vector<uint32_t> uniformIndices(memberIndices.begin(), memberIndices.end());
+		std::vector<int32_t> offsets(memberCount);
+		std::vector<int32_t> types(memberCount);
+		std::vector<int32_t> sizes(memberCount);
+		glGetActiveUniformsiv(m_program.get(), memberCount, uniformIndices.data(), GL_UNIFORM_OFFSET, offsets.data());
+		glGetActiveUniformsiv(m_program.get(), memberCount, uniformIndices.data(), GL_UNIFORM_TYPE, types.data());
+		glGetActiveUniformsiv(m_program.get(), memberCount, uniformIndices.data(), GL_UNIFORM_SIZE, sizes.data());
+
+		UniformBlockInfo info{ std::move(blockName), index, static_cast<uint32_t>(binding), dataSize, {} };
+		for (int32_t member{ 0 }; member < memberCount; ++member) {
+			int32_t memberNameLength{ 0 };
+			glGetActiveUniformsiv(m_program.get(), 1, &uniformIndices[member], GL_UNIFORM_NAME_LENGTH, &memberNameLength);
+			std::string memberName(std::max(memberNameLength, 1), '\0');
+			glGetActiveUniformName(m_program.get(), uniformIndices[member], memberNameLength, &length, memberName.data());
+			memberName.resize(length);
+			info.members.push_back(UniformBlockMember{
+				std::move(memberName), uniformTypeFromGl(types[member]), sizes[member], offsets[member]
+			});
+		}
+		std::sort(info.members.begin(), info.members.end(),
+			[](const UniformBlockMember& a, const UniformBlockMember& b) { return a.offset < b.offset; });
+		m_uniformBlocks.push_back(std::move(info));
+	}
+}
+
+void ShaderProgram::addUniform(std::string uniformName, int32_t location, UniformType type) {
+	if (m_uniformIndex.contains(uniformName)) {
+		// Declared by both stages of a SPIR-V program.
+		return;
+	}
+	auto index{ static_cast<uint32_t>(m_uniforms.size()) };
+	m_uniforms.push_back(UniformSlot{ location, type, false, {} });
+	// Arrays are reported as "name[0]"; let them be found by their bare name too.
+	if (uniformName.ends_with("[0]")) {
+		std::string bareName{ uniformName.substr(0, uniformName.size() - 3) };
+		m_uniformHashes.emplace_back(hashUniformName(bareName), index);
+		m_uniformIndex.emplace(std::move(bareName), index);
+	}
+	m_uniformHashes.emplace_back(hashUniformName(uniformName), index);
+	m_uniformIndex.emplace(std::move(uniformName), index);
+}
+
+uint32_t ShaderProgram::findUniform(std::string_view uniformName) {
+	finishLoad();
+	auto it{ m_uniformIndex.find(uniformName) };
+	if (it != m_uniformIndex.end()) {
+		++m_uniformStats.hits;
+		return it->second;
+	}
+
+	// Not an active uniform from reflection (e.g. a later array element). Ask the driver once,
+	// and remember the answer -- even -1 -- so the next lookup is a hit.
+	++m_uniformStats.misses;
+	std::string name{ uniformName };
+	auto index{ static_cast<uint32_t>(m_uniforms.size()) };
+	m_uniforms.push_back(UniformSlot{
+		glGetUniformLocation(m_program.get(), name.c_str()), UniformType::Unknown, false, {}
+	});
+	m_uniformIndex.emplace(std::move(name), index);
+	return index;
+}
+
+// Resolves a Uniform handle against the reflected uniforms, failing if the handle's type does not
+// match the type the shader declares.
+uint32_t ShaderProgram::bindUniform(uint64_t hash, UniformType type, std::string_view uniformName) {
+	finishLoad();
+	auto it{ std::lower_bound(m_uniformHashes.begin(), m_uniformHashes.end(),
+		std::pair<uint64_t, uint32_t>{ hash, 0 }) };
+	uint32_t slot{ (it != m_uniformHashes.end() && it->first == hash)
+		? it->second
+		: findUniform(uniformName) };
+
+	UniformType declared{ m_uniforms[slot].type };
+	if (!uniformTypeCompatible(declared, type)) {
+		throw std::runtime_error("Uniform '" + std::string{ uniformName } + "' is declared as "
+			+ uniformTypeName(declared) + " but bound as " + uniformTypeName(type));
+	}
+	return slot;
+}
+
+// Records the value in the uniform's shadow copy, returning the slot only if the value differs
+// from what was last uploaded and a glUniform* call is actually needed.
+template <typename T>
+ShaderProgram::UniformSlot* ShaderProgram::updateUniform(uint32_t slot, const T& value) {
+	static_assert(sizeof(T) <= sizeof(UniformSlot::value));
+	UniformSlot& uniform{ m_uniforms[slot] };
+	if (uniform.location < 0) {
+		return nullptr;
+	}
+	if (uniform.hasValue && std::memcmp(uniform.value.data(), &value, sizeof(T)) == 0) {
+		++m_uniformStats.skippedUploads;
+		return nullptr;
+	}
+	std::memcpy(uniform.value.data(), &value, sizeof(T));
+	uniform.hasValue = true;
+	++m_uniformStats.uploads;
+	return &uniform;
 }
 
 void ShaderProgram::activate() {
-	glUseProgram(m_programId);
+	finishLoad();
+	glUseProgram(m_program.get());
+}
+
+bool ShaderProgram::isActive() const {
+	int32_t current{ 0 };
+	glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+	return m_program && static_cast<uint32_t>(current) == m_program.get();
+}
+
+bool ShaderProgram::isLoaded() const {
+	return m_pendingLink || m_program;
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, bool value) {
-	glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), (int32_t)value);
+// Deletes the GL program, leaving this ShaderProgram empty.
+void ShaderProgram::unload() {
+	m_pendingLink.reset();
+	m_program.reset();
+	m_separableStage.reset();
+	m_binaryKey = NO_BINARY_CACHE;
+	m_declaredUniforms.clear();
+	m_uniformBlocks.clear();
+	m_uniforms.clear();
+	m_uniformIndex.clear();
+	m_uniformHashes.clear();
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, int32_t value) {
-	glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), value);
+void ShaderProgram::setUniform(std::string_view uniformName, bool value) {
+	setUniformSlot(findUniform(uniformName), value);
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, float value) {
-	glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), value);
+void ShaderProgram::setUniform(std::string_view uniformName, int32_t value) {
+	setUniformSlot(findUniform(uniformName), value);
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec2& value) {
-	glUniform2fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+void ShaderProgram::setUniform(std::string_view uniformName, float value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::vec2& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::vec3& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::vec4& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::mat2& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::mat3& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniform(std::string_view uniformName, const glm::mat4& value) {
+	setUniformSlot(findUniform(uniformName), value);
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, bool value) {
+	setUniformSlot(slot, static_cast<int32_t>(value));
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, int32_t value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			// Separable programs are bound through a pipeline, not glUseProgram.
+			glProgramUniform1i(m_program.get(), uniform->location, value);
+			return;
+		}
+#endif
+		glUniform1i(uniform->location, value);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, float value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniform1f(m_program.get(), uniform->location, value);
+			return;
+		}
+#endif
+		glUniform1f(uniform->location, value);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::vec2& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniform2fv(m_program.get(), uniform->location, 1, &value[0]);
+			return;
+		}
+#endif
+		glUniform2fv(uniform->location, 1, &value[0]);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::vec3& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniform3fv(m_program.get(), uniform->location, 1, &value[0]);
+			return;
+		}
+#endif
+		glUniform3fv(uniform->location, 1, &value[0]);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::vec4& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniform4fv(m_program.get(), uniform->location, 1, &value[0]);
+			return;
+		}
+#endif
+		glUniform4fv(uniform->location, 1, &value[0]);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::mat2& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniformMatrix2fv(m_program.get(), uniform->location, 1, false, &value[0][0]);
+			return;
+		}
+#endif
+		glUniformMatrix2fv(uniform->location, 1, false, &value[0][0]);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::mat3& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniformMatrix3fv(m_program.get(), uniform->location, 1, false, &value[0][0]);
+			return;
+		}
+#endif
+		glUniformMatrix3fv(uniform->location, 1, false, &value[0][0]);
+	}
+}
+
+void ShaderProgram::setUniformSlot(uint32_t slot, const glm::mat4& value) {
+	if (auto uniform{ updateUniform(slot, value) }) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+		if (m_separableStage) {
+			glProgramUniformMatrix4fv(m_program.get(), uniform->location, 1, false, &value[0][0]);
+			return;
+		}
+#endif
+		glUniformMatrix4fv(uniform->location, 1, false, &value[0][0]);
+	}
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec3& value) {
-	glUniform3fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+const std::vector<UniformBlockInfo>& ShaderProgram::uniformBlocks() {
+	finishLoad();
+	return m_uniformBlocks;
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec4& value) {
-	glUniform4fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+const UniformBlockInfo* ShaderProgram::uniformBlock(std::string_view blockName) {
+	finishLoad();
+	auto it{ std::find_if(m_uniformBlocks.begin(), m_uniformBlocks.end(),
+		[&](const UniformBlockInfo& block) { return block.name == blockName; }) };
+	return it != m_uniformBlocks.end() ? &*it : nullptr;
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat2& value) {
-	glUniformMatrix2fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+const UniformCacheStats& ShaderProgram::uniformStats() const {
+	return m_uniformStats;
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat3& value) {
-	glUniformMatrix3fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+void ShaderProgram::resetUniformStats() {
+	m_uniformStats = {};
 }
 
-void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat4& value) {
-	glUniformMatrix4fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+const ShaderLoadReport& ShaderProgram::loadReport() const {
+	return m_loadReport;
 }
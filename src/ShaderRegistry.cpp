@@ -0,0 +1,133 @@
+#include "ShaderRegistry.h"
+#include <initializer_list>
+#include <string_view>
+#include "Hash.h"
+
+namespace {
+	uint64_t shaderKey(ShaderStage stage, const std::string& path, const std::string& code) {
+		uint64_t key{ fnv1a(stage == ShaderStage::Vertex ? "vertex" : "fragment") };
+		key = fnv1a(std::string_view{ "\0", 1 }, fnv1a(path, key));
+		return fnv1a(code, key);
+	}
+
+	// Hashes both keys' bytes together, so programs sharing a shader still get unrelated keys.
+	uint64_t combineKeys(uint64_t first, uint64_t second) {
+		uint64_t keys[2]{ first, second };
+		return fnv1a(std::string_view{ reinterpret_cast<const char*>(keys), sizeof(keys) });
+	}
+
+	// Identifies a request by what was asked for, before anything is read or preprocessed.
+	uint64_t requestKey(std::string_view kind, std::initializer_list<std::string_view> paths,
+		const ShaderDefines& defines) {
+		uint64_t key{ fnv1a(kind) };
+		for (std::string_view path : paths) {
+			key = fnv1a(std::string_view{ "\0", 1 }, fnv1a(path, key));
+		}
+		for (const auto& [name, value] : defines) {
+			key = fnv1a(std::string_view{ "\0", 1 }, fnv1a(name, key));
+			key = fnv1a(std::string_view{ "\0", 1 }, fnv1a(value, key));
+		}
+		return key;
+	}
+}
+
+ShaderRegistry::ShaderRegistry(ShaderFileReader readFile)
+	: m_readFile(std::move(readFile)), m_shaders{}, m_programs{}, m_requests{} {
+}
+
+ShaderProgram& ShaderRegistry::program(const std::string& vertexShaderPath,
+	const std::string& fragmentShaderPath, const ShaderDefines& defines) {
+	uint64_t request{ requestKey("program", { vertexShaderPath, fragmentShaderPath }, defines) };
+	if (ShaderProgram* known{ requested(request) }) {
+		return *known;
+	}
+
+	PreprocessedShader vertex{ preprocessShader(vertexShaderPath, defines, m_readFile) };
+	PreprocessedShader fragment{ preprocessShader(fragmentShaderPath, defines, m_readFile) };
+	uint64_t vertexKey{ shaderKey(ShaderStage::Vertex, vertexShaderPath, vertex.source) };
+	uint64_t fragmentKey{ shaderKey(ShaderStage::Fragment, fragmentShaderPath, fragment.source) };
+	uint64_t programKey{ combineKeys(vertexKey, fragmentKey) };
+
+	auto existing{ m_programs.find(programKey) };
+	if (existing != m_programs.end()) {
+		if (existing->second->isLoaded()) {
+			return *existing->second;
+		}
+		// It failed to compile or link last time. Drop the shaders too, so they're compiled afresh.
+		m_shaders.erase(vertexKey);
+		m_shaders.erase(fragmentKey);
+		m_programs.erase(existing);
+	}
+
+	auto program{ std::make_unique<ShaderProgram>() };
+	uint64_t cacheKey{ ShaderProgram::binaryCacheKey(vertex.source, fragment.source) };
+	if (!program->loadBinary(cacheKey)) {
+		program->linkAsync(shader(ShaderStage::Vertex, vertexKey, vertex.source),
+			shader(ShaderStage::Fragment, fragmentKey, fragment.source), cacheKey);
+	}
+	auto [entry, inserted] { m_programs.emplace(programKey, std::move(program)) };
+	m_requests[request] = programKey;
+	return *entry->second;
+}
+
+ShaderProgram& ShaderRegistry::stage(ShaderStage stage, const std::string& shaderPath,
+	const ShaderDefines& defines) {
+	uint64_t request{ requestKey(stage == ShaderStage::Vertex ? "vertex stage" : "fragment stage", { shaderPath },
+		defines) };
+	if (ShaderProgram* known{ requested(request) }) {
+		return *known;
+	}
+
+	PreprocessedShader shader{ preprocessShader(shaderPath, defines, m_readFile) };
+	uint64_t programKey{ fnv1a("separable", shaderKey(stage, shaderPath, shader.source)) };
+
+	auto existing{ m_programs.find(programKey) };
+	if (existing != m_programs.end()) {
+		if (existing->second->isLoaded()) {
+			return *existing->second;
+		}
+		m_programs.erase(existing);
+	}
+
+	// The shader is compiled from a separable variant of the source, so it isn't shared with
+	// monolithic programs and is owned by the program instead of m_shaders.
+	auto program{ std::make_unique<ShaderProgram>() };
+	program->loadStageSourceAsync(stage, shader.source);
+	auto [entry, inserted] { m_programs.emplace(programKey, std::move(program)) };
+	m_requests[request] = programKey;
+	return *entry->second;
+}
+
+// The program an earlier request with this key got, if it is still loaded. A failed one goes
+// through the whole lookup again, so its shaders are reread and rebuilt.
+ShaderProgram* ShaderRegistry::requested(uint64_t request) {
+	auto known{ m_requests.find(request) };
+	if (known == m_requests.end()) {
+		return nullptr;
+	}
+	auto existing{ m_programs.find(known->second) };
+	return existing != m_programs.end() && existing->second->isLoaded() ? existing->second.get() : nullptr;
+}
+
+// Returns the shader object for this source, submitting its compile if it hasn't been seen before.
+uint32_t ShaderRegistry::shader(ShaderStage stage, uint64_t key, const std::string& code) {
+	auto it{ m_shaders.find(key) };
+	if (it == m_shaders.end()) {
+		it = m_shaders.emplace(key, ShaderProgram::compileShaderAsync(stage, code)).first;
+	}
+	return it->second.get();
+}
+
+size_t ShaderRegistry::shaderCount() const {
+	return m_shaders.size();
+}
+
+size_t ShaderRegistry::programCount() const {
+	return m_programs.size();
+}
+
+void ShaderRegistry::clear() {
+	m_requests.clear();
+	m_programs.clear();
+	m_shaders.clear();
+}
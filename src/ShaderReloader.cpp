@@ -0,0 +1,274 @@
+#include "ShaderReloader.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// How often the watcher thread checks for a stop request, or polls modification times where
+	// inotify isn't available.
+	const int WATCH_INTERVAL_MS{ 100 };
+
+	std::string normalizePath(const std::filesystem::path& path) {
+		return path.lexically_normal().generic_string();
+	}
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+ShaderReloader::ShaderReloader()
+	: m_programs{}, m_sources{}, m_stats{}, m_mutex{}, m_watchedFiles{}, m_changed{} {
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0) {
+		std::cout << "WARNING: inotify unavailable, shader hot reload is disabled" << std::endl;
+		return;
+	}
+#endif
+	m_watcher = std::jthread{ [this](std::stop_token stop) { watchFiles(stop); } };
+}
+
+ShaderReloader::~ShaderReloader() {
+	if (m_watcher.joinable()) {
+		m_watcher.request_stop();
+		m_watcher.join();
+	}
+#ifdef __linux__
+	if (m_inotify >= 0) {
+		close(m_inotify);
+	}
+#endif
+}
+
+void ShaderReloader::watch(ShaderProgram& program, const std::string& vertexShaderPath,
+	const std::string& fragmentShaderPath, const ShaderDefines& defines) {
+	WatchedProgram watched{
+		&program, normalizePath(vertexShaderPath), normalizePath(fragmentShaderPath), defines, {}, {}, false, {}
+	};
+	for (const std::string& path : { watched.vertexShaderPath, watched.fragmentShaderPath }) {
+		try {
+			auto files{ preprocessShader(path, defines, [this](const std::string& file) { return readSource(file); }).files };
+			watched.files.insert(watched.files.end(), files.begin(), files.end());
+		}
+		catch (std::runtime_error&) {
+			// Missing for now; watch the file itself so the program reloads once it appears.
+			addWatchedFile(path);
+			watched.files.push_back(path);
+		}
+	}
+	m_programs.push_back(std::move(watched));
+}
+
+// Returns the latest contents of a watched file. Files seen for the first time (e.g. a newly
+// #included one) are read from disk and start being watched.
+std::optional<std::string> ShaderReloader::readSource(const std::string& path) {
+	auto it{ m_sources.find(path) };
+	if (it != m_sources.end()) {
+		return it->second;
+	}
+	std::optional<std::string> code{ readShaderFile(path) };
+	if (code) {
+		m_sources.emplace(path, *code);
+		addWatchedFile(path);
+	}
+	return code;
+}
+
+void ShaderReloader::addWatchedFile(const std::string& path) {
+	std::lock_guard lock{ m_mutex };
+	if (std::find(m_watchedFiles.begin(), m_watchedFiles.end(), path) != m_watchedFiles.end()) {
+		return;
+	}
+	m_watchedFiles.push_back(path);
+
+#ifdef __linux__
+	if (m_inotify < 0) {
+		return;
+	}
+	std::filesystem::path directory{ std::filesystem::path{ path }.parent_path() };
+	if (directory.empty()) {
+		directory = ".";
+	}
+	// Editors often save by writing a new file and renaming it over the old one, so watch the
+	// directory rather than the file itself.
+	int descriptor{ inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) };
+	if (descriptor >= 0) {
+		m_watchedDirectories.emplace(descriptor, directory);
+	}
+#endif
+}
+
+void ShaderReloader::unwatch(const ShaderProgram& program) {
+	std::erase_if(m_programs, [&](const WatchedProgram& watched) { return watched.program == &program; });
+}
+
+// Runs on the watcher thread. Reads the new contents of a changed file, so update() never has to
+// touch the disk.
+void ShaderReloader::fileChanged(const std::string& path) {
+	auto changedAt{ Clock::now() };
+	std::optional<std::string> code{ readShaderFile(path) };
+	if (!code) {
+		// Probably caught mid-save; the write that finishes the save will trigger another change.
+		return;
+	}
+	std::lock_guard lock{ m_mutex };
+	auto [it, inserted] { m_changed.try_emplace(path, ChangedSource{ {}, changedAt }) };
+	it->second.code = std::move(*code);
+}
+
+#ifdef __linux__
+void ShaderReloader::watchFiles(std::stop_token stop) {
+	alignas(inotify_event) char buffer[4096];
+	pollfd descriptor{ m_inotify, POLLIN, 0 };
+	while (!stop.stop_requested()) {
+		if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) {
+			continue;
+		}
+		ssize_t length{ read(m_inotify, buffer, sizeof(buffer)) };
+		std::vector<std::string> changed;
+		for (ssize_t offset{ 0 }; offset < length; ) {
+			auto event{ reinterpret_cast<const inotify_event*>(buffer + offset) };
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0) {
+				continue;
+			}
+
+			std::lock_guard lock{ m_mutex };
+			auto directory{ m_watchedDirectories.find(event->wd) };
+			if (directory == m_watchedDirectories.end()) {
+				continue;
+			}
+			std::string path{ normalizePath(directory->second / event->name) };
+			if (std::find(m_watchedFiles.begin(), m_watchedFiles.end(), path) != m_watchedFiles.end()
+				&& std::find(changed.begin(), changed.end(), path) == changed.end()) {
+				changed.push_back(std::move(path));
+			}
+		}
+		for (const std::string& path : changed) {
+			fileChanged(path);
+		}
+	}
+}
+#else
+void ShaderReloader::watchFiles(std::stop_token stop) {
+	std::unordered_map<std::string, std::filesystem::file_time_type> lastWrite;
+	while (!stop.stop_requested()) {
+		std::vector<std::string> files;
+		{
+			std::lock_guard lock{ m_mutex };
+			files = m_watchedFiles;
+		}
+		for (const std::string& path : files) {
+			std::error_code error;
+			auto time{ std::filesystem::last_write_time(path, error) };
+			if (error) {
+				continue;
+			}
+			auto [it, inserted] { lastWrite.try_emplace(path, time) };
+			if (!inserted && it->second != time) {
+				it->second = time;
+				fileChanged(path);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds{ WATCH_INTERVAL_MS });
+	}
+}
+#endif
+
+void ShaderReloader::update() {
+	auto start{ Clock::now() };
+
+	std::unordered_map<std::string, ChangedSource> changed;
+	{
+		std::lock_guard lock{ m_mutex };
+		changed.swap(m_changed);
+	}
+	for (auto& [path, source] : changed) {
+		m_sources[path] = source.code;
+	}
+
+	for (WatchedProgram& watched : m_programs) {
+		auto changedAt{ Clock::time_point::max() };
+		for (const std::string& file : watched.files) {
+			auto it{ changed.find(file) };
+			if (it != changed.end()) {
+				changedAt = std::min(changedAt, it->second.changedAt);
+			}
+		}
+		if (changedAt != Clock::time_point::max()) {
+			if (watched.reloading) {
+				// Superseded by a newer edit before it finished; keep measuring from the first one.
+				watched.candidate.unload();
+				changedAt = std::min(changedAt, watched.changedAt);
+			}
+			watched.changedAt = changedAt;
+			startReload(watched);
+		}
+
+		if (!watched.reloading || !watched.candidate.isReady()) {
+			continue;
+		}
+		watched.reloading = false;
+		try {
+			watched.candidate.finishLoad();
+		}
+		catch (std::runtime_error& e) {
+			std::cout << "ERROR: reloading " << watched.vertexShaderPath << " + "
+				<< watched.fragmentShaderPath << " failed, keeping the old program: " << e.what() << std::endl;
+			watched.candidate.unload();
+			++m_stats.failures;
+			continue;
+		}
+
+		bool wasActive{ watched.program->isActive() };
+		uint64_t supersededKey{ watched.program->binaryKey() };
+		*watched.program = std::move(watched.candidate);
+		watched.candidate = ShaderProgram{};
+		// Every edit is stored under a new key, so drop the old program's binary rather than let
+		// them pile up in the cache.
+		if (supersededKey != watched.program->binaryKey()) {
+			ShaderProgram::discardBinary(supersededKey);
+		}
+		if (wasActive) {
+			watched.program->activate();
+		}
+
+		++m_stats.reloads;
+		m_stats.lastLatency = millisecondsSince(watched.changedAt);
+		m_stats.maxLatency = std::max(m_stats.maxLatency, m_stats.lastLatency);
+	}
+
+	m_stats.lastUpdateTime = millisecondsSince(start);
+	m_stats.maxUpdateTime = std::max(m_stats.maxUpdateTime, m_stats.lastUpdateTime);
+}
+
+// Preprocesses the program's sources from memory and submits the recompile.
+void ShaderReloader::startReload(WatchedProgram& watched) {
+	auto reader{ [this](const std::string& file) { return readSource(file); } };
+	try {
+		PreprocessedShader vertex{ preprocessShader(watched.vertexShaderPath, watched.defines, reader) };
+		PreprocessedShader fragment{ preprocessShader(watched.fragmentShaderPath, watched.defines, reader) };
+		watched.files = vertex.files;
+		watched.files.insert(watched.files.end(), fragment.files.begin(), fragment.files.end());
+		watched.candidate.loadSourceAsync(vertex.source, fragment.source);
+		watched.reloading = true;
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: reloading " << watched.vertexShaderPath << " + "
+			<< watched.fragmentShaderPath << " failed, keeping the old program: " << e.what() << std::endl;
+		watched.reloading = false;
+		++m_stats.failures;
+	}
+}
+
+const ShaderReloadStats& ShaderReloader::stats() const {
+	return m_stats;
+}
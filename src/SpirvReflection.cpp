@@ -0,0 +1,161 @@
+#include "SpirvReflection.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+	const uint32_t SPIRV_MAGIC{ 0x07230203 };
+	const size_t SPIRV_HEADER_WORDS{ 5 };
+
+	// The few opcodes, decorations and storage classes reflection needs, from the SPIR-V spec.
+	enum SpirvOp : uint16_t {
+		OpName = 5,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypePointer = 32,
+		OpFunction = 54,
+		OpVariable = 59,
+		OpDecorate = 71,
+	};
+	const uint32_t DECORATION_LOCATION{ 30 };
+	const uint32_t STORAGE_CLASS_UNIFORM_CONSTANT{ 0 };
+
+	// A type declaration: its opcode, plus the type it is built from and how many of them (the
+	// component type of a vector, the column type of a matrix, the pointee of a pointer, ...).
+	struct SpirvType {
+		uint16_t op;
+		uint32_t element;
+		uint32_t count;
+	};
+
+	UniformType uniformType(const std::unordered_map<uint32_t, SpirvType>& types, uint32_t id) {
+		auto it{ types.find(id) };
+		if (it == types.end()) {
+			return UniformType::Unknown;
+		}
+		const SpirvType& type{ it->second };
+		switch (type.op) {
+		case OpTypeBool: return UniformType::Bool;
+		case OpTypeInt: return UniformType::Int;
+		case OpTypeFloat: return UniformType::Float;
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+			return UniformType::Sampler;
+		case OpTypeArray: return uniformType(types, type.element);
+		case OpTypeVector:
+			if (uniformType(types, type.element) != UniformType::Float) {
+				return UniformType::Unknown;
+			}
+			switch (type.count) {
+			case 2: return UniformType::Vec2;
+			case 3: return UniformType::Vec3;
+			case 4: return UniformType::Vec4;
+			default: return UniformType::Unknown;
+			}
+		case OpTypeMatrix: {
+			UniformType column{ uniformType(types, type.element) };
+			if (column == UniformType::Vec2 && type.count == 2) return UniformType::Mat2;
+			if (column == UniformType::Vec3 && type.count == 3) return UniformType::Mat3;
+			if (column == UniformType::Vec4 && type.count == 4) return UniformType::Mat4;
+			return UniformType::Unknown;
+		}
+		default: return UniformType::Unknown;
+		}
+	}
+}
+
+std::vector<DeclaredUniform> reflectSpirvUniforms(std::span<const uint32_t> module) {
+	if (module.size() < SPIRV_HEADER_WORDS || module[0] != SPIRV_MAGIC) {
+		throw std::runtime_error("Not a SPIR-V module");
+	}
+
+	std::unordered_map<uint32_t, std::string> names;
+	std::unordered_map<uint32_t, int32_t> locations;
+	std::unordered_map<uint32_t, SpirvType> types;
+	// (pointer type, variable id) of every UniformConstant variable, in declaration order.
+	std::vector<std::pair<uint32_t, uint32_t>> variables;
+
+	size_t offset{ SPIRV_HEADER_WORDS };
+	while (offset < module.size()) {
+		uint32_t wordCount{ module[offset] >> 16 };
+		auto op{ static_cast<uint16_t>(module[offset] & 0xFFFF) };
+		if (wordCount == 0 || offset + wordCount > module.size()) {
+			throw std::runtime_error("Malformed SPIR-V module");
+		}
+		std::span<const uint32_t> operands{ module.subspan(offset + 1, wordCount - 1) };
+		offset += wordCount;
+
+		// Everything reflection needs is declared before the first function.
+		if (op == OpFunction) {
+			break;
+		}
+		switch (op) {
+		case OpName:
+			if (operands.size() >= 2) {
+				const char* name{ reinterpret_cast<const char*>(operands.data() + 1) };
+				names[operands[0]] = std::string{ name, strnlen(name, (operands.size() - 1) * sizeof(uint32_t)) };
+			}
+			break;
+		case OpDecorate:
+			if (operands.size() >= 3 && operands[1] == DECORATION_LOCATION) {
+				locations[operands[0]] = static_cast<int32_t>(operands[2]);
+			}
+			break;
+		case OpTypeBool:
+		case OpTypeInt:
+		case OpTypeFloat:
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+			if (!operands.empty()) {
+				types[operands[0]] = SpirvType{ op, 0, 0 };
+			}
+			break;
+		case OpTypeVector:
+		case OpTypeMatrix:
+			if (operands.size() >= 3) {
+				types[operands[0]] = SpirvType{ op, operands[1], operands[2] };
+			}
+			break;
+		case OpTypeArray:
+			if (operands.size() >= 2) {
+				types[operands[0]] = SpirvType{ op, operands[1], 0 };
+			}
+			break;
+		case OpTypePointer:
+			if (operands.size() >= 3) {
+				types[operands[0]] = SpirvType{ op, operands[2], operands[1] };
+			}
+			break;
+		case OpVariable:
+			if (operands.size() >= 3 && operands[2] == STORAGE_CLASS_UNIFORM_CONSTANT) {
+				variables.emplace_back(operands[0], operands[1]);
+			}
+			break;
+		}
+	}
+
+	std::vector<DeclaredUniform> uniforms;
+	for (const auto& [pointerType, variable] : variables) {
+		auto location{ locations.find(variable) };
+		auto name{ names.find(variable) };
+		auto pointer{ types.find(pointerType) };
+		if (location == locations.end() || name == names.end() || name->second.empty()
+			|| pointer == types.end()) {
+			continue;
+		}
+		uniforms.push_back(DeclaredUniform{
+			name->second, location->second, uniformType(types, pointer->second.element)
+		});
+	}
+	return uniforms;
+}
@@ -0,0 +1,149 @@
+#include "StreamBuffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+StreamBuffer::StreamBuffer(uint32_t target, size_t frameSize, uint32_t framesInFlight)
+	: m_target(target), m_frameSize(frameSize), m_framesInFlight(std::max(framesInFlight, 1u)), m_alignment(16),
+	m_buffer{}, m_persistent(persistentMappingSupported()), m_mapped(nullptr), m_mappedStart(0),
+	m_frame(0), m_frameOffset(0), m_fences(m_framesInFlight, nullptr), m_stats{} {
+	if (m_target == GL_UNIFORM_BUFFER) {
+		int32_t alignment{ 0 };
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_alignment = std::max<size_t>(m_alignment, alignment);
+	}
+	m_frameSize = (m_frameSize + m_alignment - 1) / m_alignment * m_alignment;
+
+	uint32_t buffer{ 0 };
+	glGenBuffers(1, &buffer);
+	m_buffer = GlBuffer{ buffer };
+	glBindBuffer(m_target, m_buffer.get());
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+	if (m_persistent) {
+		GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+		size_t size{ m_frameSize * m_framesInFlight };
+		glBufferStorage(m_target, size, nullptr, flags);
+		m_mapped = static_cast<std::byte*>(glMapBufferRange(m_target, 0, size, flags));
+	}
+#endif
+	if (!m_mapped) {
+		m_persistent = false;
+		glBufferData(m_target, m_frameSize * m_framesInFlight, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(m_target, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (__GLsync* fence : m_fences) {
+		if (fence) {
+			glDeleteSync(fence);
+		}
+	}
+	if (m_mapped && m_buffer) {
+		glBindBuffer(m_target, m_buffer.get());
+		glUnmapBuffer(m_target);
+		glBindBuffer(m_target, 0);
+	}
+}
+
+bool StreamBuffer::persistentMappingSupported() {
+	bool available{ false };
+#ifdef GL_VERSION_4_4
+	available = available || GLAD_GL_VERSION_4_4;
+#endif
+#ifdef GL_ARB_buffer_storage
+	available = available || GLAD_GL_ARB_buffer_storage;
+#endif
+	return available;
+}
+
+size_t StreamBuffer::regionStart() const {
+	return m_frame * m_frameSize;
+}
+
+void StreamBuffer::waitForFence(uint32_t frame) {
+	__GLsync* fence{ m_fences[frame] };
+	if (!fence) {
+		return;
+	}
+	auto start{ std::chrono::steady_clock::now() };
+	// Poll first. Only if the GPU is behind, flush the fence to it and block.
+	GLbitfield flags{ 0 };
+	GLenum result{ glClientWaitSync(fence, flags, 0) };
+	if (result == GL_TIMEOUT_EXPIRED) {
+		++m_stats.fenceWaits;
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			result = glClientWaitSync(fence, flags, 1'000'000'000);
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+		m_stats.waitMilliseconds += std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+	glDeleteSync(fence);
+	m_fences[frame] = nullptr;
+}
+
+void StreamBuffer::beginFrame() {
+	m_frame = (m_frame + 1) % m_framesInFlight;
+	waitForFence(m_frame);
+	m_frameOffset = 0;
+}
+
+void StreamBuffer::endFrame() {
+	flush();
+	if (m_fences[m_frame]) {
+		glDeleteSync(m_fences[m_frame]);
+	}
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	++m_stats.frames;
+	m_stats.peakFrameBytes = std::max(m_stats.peakFrameBytes, m_frameOffset);
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size) {
+	size_t offset{ m_frameOffset };
+	if (offset + size > m_frameSize) {
+		throw std::runtime_error("StreamBuffer is out of space for this frame ("
+			+ std::to_string(m_frameSize) + " bytes)");
+	}
+	if (m_persistent) {
+		m_frameOffset = (offset + size + m_alignment - 1) / m_alignment * m_alignment;
+		return StreamAllocation{ m_mapped + regionStart() + offset, regionStart() + offset, size };
+	}
+
+	if (!m_mapped) {
+		// The rest of the region, once per frame (or per flush). The fence waited on in beginFrame
+		// means the GPU is done with it, so the driver needn't sync, and nothing in it is kept.
+		glBindBuffer(m_target, m_buffer.get());
+		m_mapped = static_cast<std::byte*>(glMapBufferRange(m_target, regionStart() + offset, m_frameSize - offset,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+		glBindBuffer(m_target, 0);
+		if (!m_mapped) {
+			throw std::runtime_error("StreamBuffer could not map its frame region");
+		}
+		m_mappedStart = offset;
+	}
+	m_frameOffset = (offset + size + m_alignment - 1) / m_alignment * m_alignment;
+	return StreamAllocation{ m_mapped + (offset - m_mappedStart), regionStart() + offset, size };
+}
+
+void StreamBuffer::bindRange(uint32_t index, const StreamAllocation& allocation) {
+	glBindBufferRange(m_target, index, m_buffer.get(), allocation.offset, allocation.size);
+}
+
+void StreamBuffer::flush() {
+	if (m_persistent || !m_mapped) {
+		return;
+	}
+	glBindBuffer(m_target, m_buffer.get());
+	glFlushMappedBufferRange(m_target, 0, m_frameOffset - m_mappedStart);
+	glUnmapBuffer(m_target);
+	glBindBuffer(m_target, 0);
+	m_mapped = nullptr;
+}
+
+const StreamBufferStats& StreamBuffer::stats() const {
+	return m_stats;
+}
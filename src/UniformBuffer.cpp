@@ -0,0 +1,177 @@
+#include "UniformBuffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	struct Std140Size {
+		uint32_t alignment;
+		uint32_t size;
+	};
+
+	// Base alignment and size of a single (non-array) member under std140. Matrices are stored as
+	// arrays of column vectors, each padded to a vec4.
+	Std140Size std140Size(UniformType type) {
+		switch (type) {
+		case UniformType::Bool:
+		case UniformType::Int:
+		case UniformType::Float:
+			return { 4, 4 };
+		case UniformType::Vec2: return { 8, 8 };
+		case UniformType::Vec3: return { 16, 12 };
+		case UniformType::Vec4: return { 16, 16 };
+		case UniformType::Mat2: return { 16, 32 };
+		case UniformType::Mat3: return { 16, 48 };
+		case UniformType::Mat4: return { 16, 64 };
+		default:
+			throw std::runtime_error("Uniform blocks can't contain samplers or unknown types");
+		}
+	}
+
+	uint32_t alignUp(uint32_t value, uint32_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Block members are reported as "Block.member" when the block has an instance name, and
+	// arrays as "member[0]".
+	std::string_view bareMemberName(std::string_view name, std::string_view blockName) {
+		if (name.size() > blockName.size() && name.starts_with(blockName) && name[blockName.size()] == '.') {
+			name.remove_prefix(blockName.size() + 1);
+		}
+		if (name.ends_with("[0]")) {
+			name.remove_suffix(3);
+		}
+		return name;
+	}
+}
+
+Std140Layout::Std140Layout()
+	: m_members{}, m_size(0) {
+}
+
+// Arrays, and structs if we ever need them, round each element up to a vec4.
+Std140Layout& Std140Layout::add(std::string name, UniformType type, uint32_t arraySize) {
+	Std140Size element{ std140Size(type) };
+	uint32_t alignment{ element.alignment };
+	uint32_t size{ element.size };
+	if (arraySize > 1) {
+		alignment = 16;
+		size = alignUp(element.size, 16) * arraySize;
+	}
+	uint32_t offset{ alignUp(m_size, alignment) };
+	m_members.push_back(Member{ std::move(name), type, arraySize, offset });
+	m_size = offset + size;
+	return *this;
+}
+
+const Std140Layout::Member* Std140Layout::member(std::string_view name) const {
+	auto it{ std::find_if(m_members.begin(), m_members.end(),
+		[&](const Member& member) { return member.name == name; }) };
+	return it != m_members.end() ? &*it : nullptr;
+}
+
+const std::vector<Std140Layout::Member>& Std140Layout::members() const {
+	return m_members;
+}
+
+uint32_t Std140Layout::size() const {
+	return alignUp(m_size, 16);
+}
+
+UniformBuffer::UniformBuffer(SharedUniformBlock block, Std140Layout layout)
+	: m_block(block), m_layout(std::move(layout)), m_data(m_layout.size()), m_buffer{},
+	m_dirtyBegin(0), m_dirtyEnd(0), m_boundToStream(false) {
+	uint32_t buffer{ 0 };
+	glGenBuffers(1, &buffer);
+	m_buffer = GlBuffer{ buffer };
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer.get());
+	glBufferData(GL_UNIFORM_BUFFER, m_data.size(), m_data.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// Bound once; programs find the block at this binding point from now on.
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_block.binding, m_buffer.get());
+}
+
+// Stores the value in std140 layout, and marks its bytes for upload if they changed.
+void UniformBuffer::write(std::string_view memberName, UniformType type, const void* value, size_t size) {
+	const Std140Layout::Member* member{ m_layout.member(memberName) };
+	if (!member) {
+		throw std::runtime_error("Uniform block " + std::string{ m_block.name } + " has no member "
+			+ std::string{ memberName });
+	}
+	if (member->type != type) {
+		throw std::runtime_error("Uniform block member " + std::string{ m_block.name } + "."
+			+ std::string{ memberName } + " set with the wrong type");
+	}
+
+	// mat2 and mat3 columns are padded to a vec4 in the block, but tightly packed in glm.
+	std::byte packed[sizeof(glm::mat4)]{};
+	const std::byte* bytes{ static_cast<const std::byte*>(value) };
+	if (type == UniformType::Mat2 || type == UniformType::Mat3) {
+		size_t columns{ type == UniformType::Mat2 ? 2u : 3u };
+		size_t columnSize{ size / columns };
+		for (size_t column{ 0 }; column < columns; ++column) {
+			std::memcpy(packed + column * 16, bytes + column * columnSize, columnSize);
+		}
+		bytes = packed;
+		size = std140Size(type).size;
+	}
+
+	std::byte* destination{ m_data.data() + member->offset };
+	if (std::memcmp(destination, bytes, size) == 0) {
+		return;
+	}
+	std::memcpy(destination, bytes, size);
+	if (m_dirtyBegin >= m_dirtyEnd) {
+		m_dirtyBegin = member->offset;
+		m_dirtyEnd = member->offset + size;
+	}
+	else {
+		m_dirtyBegin = std::min<size_t>(m_dirtyBegin, member->offset);
+		m_dirtyEnd = std::max<size_t>(m_dirtyEnd, member->offset + size);
+	}
+}
+
+void UniformBuffer::upload() {
+	if (m_boundToStream) {
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_block.binding, m_buffer.get());
+		m_boundToStream = false;
+	}
+	if (m_dirtyBegin >= m_dirtyEnd) {
+		return;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer.get());
+	glBufferSubData(GL_UNIFORM_BUFFER, m_dirtyBegin, m_dirtyEnd - m_dirtyBegin, m_data.data() + m_dirtyBegin);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+}
+
+void UniformBuffer::upload(StreamBuffer& stream) {
+	StreamAllocation allocation{ stream.allocate(m_data.size()) };
+	std::memcpy(allocation.data, m_data.data(), m_data.size());
+	stream.bindRange(m_block.binding, allocation);
+	m_boundToStream = true;
+}
+
+void UniformBuffer::verify(ShaderProgram& program) const {
+	const UniformBlockInfo* block{ program.uniformBlock(m_block.name) };
+	if (!block) {
+		return;
+	}
+	for (const UniformBlockMember& reflected : block->members) {
+		std::string_view name{ bareMemberName(reflected.name, block->name) };
+		const Std140Layout::Member* member{ m_layout.member(name) };
+		if (!member || member->type != reflected.type || static_cast<int32_t>(member->offset) != reflected.offset) {
+			throw std::runtime_error("Uniform block " + block->name + " member " + std::string{ name }
+				+ " does not match its std140 layout; is the block declared layout(std140)?");
+		}
+	}
+	if (block->dataSize > static_cast<int32_t>(m_layout.size())) {
+		throw std::runtime_error("Uniform block " + block->name + " is larger than its std140 layout");
+	}
+}
+
+const Std140Layout& UniformBuffer::layout() const {
+	return m_layout;
+}
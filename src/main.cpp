@@ -1,48 +1,205 @@
 /*
-* This program renders a model loaded with assimp (bunny.obj) as a wireframe mesh,
+* This program renders a model loaded from bunny.obj as a wireframe mesh, with back faces hidden,
 * using model, view, and projection matrices to transform vertices from local to clip space.
-* The matrices are constructed in the application, and passed to the vertex shader as uniforms.
+* The matrices are constructed in the application, and passed to the vertex shader in the Camera and
+* Object uniform blocks.
 * Fragments are always green.
 */
 
 #include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <random>
 
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Window.hpp>
 #include <SFML/Graphics.hpp>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include "AssimpImport.h"
+#include "Bounds.h"
+#include "EmbeddedShaders.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "MeshProcessing.h"
+#include "MeshQuantization.h"
+#include "ObjLoader.h"
 #include "ShaderProgram.h"
+#include "ShaderRegistry.h"
+#include "ShaderReloader.h"
+#include "StreamBuffer.h"
+#include "UniformBuffer.h"
+
+// The defines a vertex shader needs to read a mesh's attributes (vertex_attributes.glsl).
+ShaderDefines vertexDefines(bool octahedralNormals) {
+	ShaderDefines defines{};
+	if (octahedralNormals) {
+		defines["OCTAHEDRAL_NORMALS"] = "1";
+	}
+	return defines;
+}
 
-struct Mesh {
-	uint32_t vao;
-	uint32_t faces;
-};
-
-struct Vertex3D {
-	float x;
-	float y;
-	float z;
-};
+ShaderDefines vertexDefines(const Mesh& m) {
+	return vertexDefines(m.octahedralNormals);
+}
 
-ShaderProgram perspectiveShader() {
-	ShaderProgram shader{};
+// Starts loading the shader program. Compile errors are reported when it is first activated.
+ShaderProgram& perspectiveShader(ShaderRegistry& shaders, const ShaderDefines& defines) {
 	try {
-		shader.load("shaders/simple_perspective.vert", "shaders/all_green.frag");
+		return shaders.program("simple_perspective.vert", "all_green.frag", defines);
 	}
 	catch (std::runtime_error& e) {
 		std::cout << "ERROR: " << e.what() << std::endl;
 		exit(1);
 	}
-	return shader;
 }
 
-Mesh constructMesh(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+#if defined(LOG_SHADER_TIMES) && defined(HAS_SPIRV_SHADERS)
+// Times linking the perspective program from GLSL source against linking it from the SPIR-V
+// modules built by the spirv target. Both bypass the program binary cache, neither reading nor
+// writing it, and the GLSL sources get a comment unique to this run, so the driver's own shader
+// cache can't answer for the compile either. Sources are read before the clock starts, so only
+// driver work is measured.
+void benchmarkSpirv() {
+	if (!ShaderProgram::spirvSupported()) {
+		std::cout << "SPIR-V benchmark skipped: needs GL 4.6 or ARB_gl_spirv" << std::endl;
+		return;
+	}
+	auto elapsed{ [](auto start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} };
+	try {
+		std::string vertexCode{ preprocessShader("simple_perspective.vert", {}, readEmbeddedShader).source };
+		std::string fragmentCode{ preprocessShader("all_green.frag", {}, readEmbeddedShader).source };
+		std::string nonce{ "\n// " + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "\n" };
+		vertexCode += nonce;
+		fragmentCode += nonce;
+		std::vector<uint32_t> vertexModule{ ShaderProgram::readSpirvModule("shaders/simple_perspective.vert.spv") };
+		std::vector<uint32_t> fragmentModule{ ShaderProgram::readSpirvModule("shaders/all_green.frag.spv") };
+
+		auto start{ std::chrono::steady_clock::now() };
+		ShaderProgram fromGlsl{};
+		GlShader vertex{ ShaderProgram::compileShaderAsync(ShaderStage::Vertex, vertexCode) };
+		GlShader fragment{ ShaderProgram::compileShaderAsync(ShaderStage::Fragment, fragmentCode) };
+		fromGlsl.linkAsync(vertex.get(), fragment.get(), ShaderProgram::NO_BINARY_CACHE);
+		fromGlsl.finishLoad();
+		double glslTime{ elapsed(start) };
+
+		start = std::chrono::steady_clock::now();
+		ShaderProgram fromSpirv{};
+		GlShader vertexSpirv{ ShaderProgram::specializeShaderAsync(ShaderStage::Vertex, vertexModule) };
+		GlShader fragmentSpirv{ ShaderProgram::specializeShaderAsync(ShaderStage::Fragment, fragmentModule) };
+		fromSpirv.linkAsync(vertexSpirv.get(), fragmentSpirv.get(), ShaderProgram::NO_BINARY_CACHE);
+		fromSpirv.finishLoad();
+		double spirvTime{ elapsed(start) };
+
+		std::cout << "Perspective shader from GLSL: " << glslTime << " ms, from SPIR-V: " << spirvTime
+			<< " ms" << std::endl;
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "SPIR-V benchmark failed: " << e.what() << std::endl;
+	}
+}
+#endif
+
+// The most of a mesh the streaming loaders hold in memory at once, and the size of the pieces they
+// upload it in.
+const size_t STREAM_CHUNK_BYTES{ 16 * 1024 * 1024 };
+// OBJ files larger than this are loaded with streamObjLoad.
+const uintmax_t STREAM_OBJ_THRESHOLD{ 256 * 1024 * 1024 };
+
+// The parts of a mesh with indexCount indices, before anything is uploaded. A model without
+// submeshes is drawn as a single one.
+Mesh describeMesh(size_t indexCount, std::span<const Submesh> submeshes = {}, std::span<const MeshLod> lods = {},
+	std::span<const Meshlet> meshlets = {}) {
 	Mesh m{};
-	m.faces = static_cast<uint32_t>(faces.size());
+	m.faces = static_cast<uint32_t>(indexCount);
+	m.submeshes.assign(submeshes.begin(), submeshes.end());
+	if (m.submeshes.empty()) {
+		m.submeshes.push_back(Submesh{ 0, m.faces, 0 });
+	}
+	else {
+		// The levels of detail's indices aren't part of the full mesh.
+		m.faces = 0;
+		for (const Submesh& submesh : m.submeshes) {
+			m.faces += submesh.indexCount;
+		}
+	}
+	m.lods.assign(lods.begin(), lods.end());
+	m.meshlets.assign(meshlets.begin(), meshlets.end());
+	m.positionTransform = glm::mat4{ 1 };
+	return m;
+}
+
+// Sets a mesh's bounds, and each of its submeshes'. A mesh drawn as a single submesh has its own
+// bounds as that submesh's.
+void setBounds(Mesh& m, const BoundingVolumes& bounds, std::span<const BoundingVolumes> submeshBounds = {}) {
+	m.bounds = bounds.sphere;
+	m.box = bounds.box;
+	m.submeshBounds.assign(submeshBounds.begin(), submeshBounds.end());
+	if (m.submeshBounds.size() != m.submeshes.size()) {
+		m.submeshBounds.assign(m.submeshes.size(), bounds);
+	}
+}
+
+// Points the bound vertex array's attributes at the bound vertex buffer, laid out as encodeVertices
+// encoded it, for whichever attributes the mesh has.
+void setVertexAttributes(Mesh& m, const EncodedVertices& encoded, const VertexAttributes& attributes,
+	VertexEncoding encoding) {
+	if (encoding.quantizePositions) {
+		// Normalized, so the shader reads each axis as [0, 1] of the mesh's bounds.
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, true, encoded.stride, 0);
+	}
+	else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, false, encoded.stride, 0);
+	}
+	glEnableVertexAttribArray(0);
+	if (!attributes.normals.empty()) {
+		const void* normalOffset{ reinterpret_cast<const void*>(static_cast<uintptr_t>(encoded.normalOffset)) };
+		if (encoding.octahedralNormals) {
+			// Decoded by vertexNormal(), with OCTAHEDRAL_NORMALS defined (see vertexDefines).
+			glVertexAttribPointer(1, 2, GL_SHORT, true, encoded.stride, normalOffset);
+			m.octahedralNormals = true;
+		}
+		else {
+			glVertexAttribPointer(1, 3, GL_FLOAT, false, encoded.stride, normalOffset);
+		}
+		glEnableVertexAttribArray(1);
+	}
+	if (!attributes.tangents.empty()) {
+		const void* tangentOffset{ reinterpret_cast<const void*>(static_cast<uintptr_t>(encoded.tangentOffset)) };
+		if (encoding.octahedralNormals) {
+			glVertexAttribPointer(2, 4, GL_SHORT, true, encoded.stride, tangentOffset);
+		}
+		else {
+			glVertexAttribPointer(2, 4, GL_FLOAT, false, encoded.stride, tangentOffset);
+		}
+		glEnableVertexAttribArray(2);
+	}
+	if (!attributes.texCoords.empty()) {
+		const void* texCoordOffset{ reinterpret_cast<const void*>(static_cast<uintptr_t>(encoded.texCoordOffset)) };
+		glVertexAttribPointer(3, 2, GL_FLOAT, false, encoded.stride, texCoordOffset);
+		glEnableVertexAttribArray(3);
+	}
+}
+
+// Uploads a model's vertices (with whichever other attributes it has) and faces into one vertex
+// buffer and one element buffer, shared by all of its submeshes, levels of detail and meshlets.
+// Vertices are stored in the given encoding, and indices in 16 bits whenever they fit.
+Mesh constructMesh(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	std::span<const Submesh> submeshes = {}, std::span<const MeshLod> lods = {}, std::span<const Meshlet> meshlets = {},
+	const VertexAttributes& attributes = {}, VertexEncoding encoding = FULL_PRECISION_ENCODING) {
+	std::span<const glm::vec3> normals{ attributes.normals };
+	Mesh m{ describeMesh(faces.size(), submeshes, lods, meshlets) };
+	MeshBounds bounds{ meshBounds(vertices, m.submeshes) };
+	setBounds(m, bounds.mesh, bounds.submeshes);
 
 	// Generate a vertex array object on the GPU.
 	glGenVertexArrays(1, &m.vao);
@@ -56,79 +213,271 @@ Mesh constructMesh(const std::vector<Vertex3D>& vertices, const std::vector<uint
 	// "Bind" the newly-generated vbo, which makes future functions operate on that specific object.
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	// This vbo is now associated with m_vao.
-	// Copy the contents of the vertices list to the buffer that lives on the GPU.
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex3D), &vertices[0], GL_STATIC_DRAW);
-	// Inform OpenGL how to interpret the buffer: each vertex is 3 contiguous floats (4 bytes each)
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex3D), 0);
-	glEnableVertexAttribArray(0);
+	[[maybe_unused]] size_t vertexBytes{ vertices.size_bytes() };
+	if (normals.empty() && attributes.tangents.empty() && attributes.texCoords.empty() && !encoding.quantizePositions) {
+		// Copy the contents of the vertices list to the buffer that lives on the GPU.
+		glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
+		// Inform OpenGL how to interpret the buffer: each vertex is 3 contiguous floats (4 bytes each)
+		glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex3D), 0);
+		glEnableVertexAttribArray(0);
+	}
+	else {
+		EncodedVertices encoded{ encodeVertices(vertices, attributes, encoding) };
+		vertexBytes = encoded.data.size();
+		glBufferData(GL_ARRAY_BUFFER, encoded.data.size(), encoded.data.data(), GL_STATIC_DRAW);
+		setVertexAttributes(m, encoded, attributes, encoding);
+		m.positionTransform = encoded.positionTransform;
+#ifdef LOG_MESH_STATS
+		glm::vec3 extent{ m.box.high - m.box.low };
+		std::cout << "Encoded " << vertices.size() << " vertices: position error " << encoded.positionError
+			<< " (" << encoded.positionError / std::max({ extent.x, extent.y, extent.z, 1e-30f }) * 100
+			<< "% of the mesh's size), normal error " << encoded.normalError << " degrees" << std::endl;
+#endif
+	}
 
 	// Generate a second buffer, to store the indices of each triangle in the mesh.
 	uint32_t ebo;
 	glGenBuffers(1, &ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint32_t), &faces[0], GL_STATIC_DRAW);
+	[[maybe_unused]] size_t indexBytes{ faces.size_bytes() };
+	if (fitsShortIndices(faces)) {
+		std::vector<uint16_t> shortFaces{ narrowIndices(faces) };
+		indexBytes = shortFaces.size() * sizeof(uint16_t);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, shortFaces.data(), GL_STATIC_DRAW);
+		m.indexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size_bytes(), faces.data(), GL_STATIC_DRAW);
+		m.indexType = GL_UNSIGNED_INT;
+	}
 
 	// Unbind the vertex array, so no one else can accidentally mess with it.
 	glBindVertexArray(0);
 
+#ifdef LOG_MESH_STATS
+	size_t fullBytes{ vertices.size_bytes() + normals.size_bytes() + attributes.tangents.size_bytes()
+		+ attributes.texCoords.size_bytes() + faces.size_bytes() };
+	std::cout << "Uploaded mesh: " << vertices.size() << " vertices, " << faces.size() / VERTICES_PER_FACE
+		<< " faces, " << vertexBytes + indexBytes << " bytes (" << fullBytes << " at full precision), "
+		<< (m.indexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << std::endl;
+#endif
+	return m;
+}
+
+// Uploads a cooked mesh as constructMesh would with COMPACT_ENCODING, but a piece at a time: the
+// buffers are made at their full size first, then each STREAM_CHUNK_BYTES of the mapped streams is
+// encoded, copied in with glBufferSubData, and released. However large the mesh is, only about a
+// piece of it is ever in memory. The bounds and largest index were worked out when it was cooked.
+// Whichever of normals, tangents and texture coordinates were cooked are interleaved with the
+// positions, as constructMesh would.
+Mesh streamCookedMesh(const CookedMesh& cooked) {
+	std::span<const Vertex3D> vertices{ cooked.vertices() };
+	VertexAttributes attributes{ cooked.attributes() };
+	std::span<const uint32_t> indices{ cooked.indices() };
+	Mesh m{ describeMesh(indices.size(), cooked.submeshes(), cooked.lods(), cooked.meshlets()) };
+	setBounds(m, cooked.bounds(), cooked.submeshBounds());
+	PositionQuantization quantization{ positionQuantization(cooked.bounds().box) };
+	m.positionTransform = quantization.transform();
+	m.indexType = cooked.maxIndex() <= UINT16_MAX ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	glGenVertexArrays(1, &m.vao);
+	glBindVertexArray(m.vao);
+	uint32_t vbo;
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	// The attributes of the vertices from first, as many as there are.
+	auto attributesOf{ [&](size_t first, size_t count) {
+		auto piece{ [&](auto stream) { return stream.empty() ? stream : stream.subspan(first, count); } };
+		return VertexAttributes{ piece(attributes.normals), piece(attributes.tangents), piece(attributes.texCoords) };
+	} };
+	// The layout is the same for every piece, so the first vertex gives the stride.
+	EncodedVertices layout{ encodeVertices(vertices.first(std::min<size_t>(vertices.size(), 1)),
+		attributesOf(0, std::min<size_t>(vertices.size(), 1)), COMPACT_ENCODING, quantization) };
+	uint32_t stride{ layout.stride };
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * stride, nullptr, GL_STATIC_DRAW);
+	size_t cookedVertexBytes{ sizeof(Vertex3D) + (attributes.normals.empty() ? 0 : sizeof(glm::vec3))
+		+ (attributes.tangents.empty() ? 0 : sizeof(glm::vec4)) + (attributes.texCoords.empty() ? 0 : sizeof(glm::vec2)) };
+	size_t chunkVertices{ STREAM_CHUNK_BYTES / cookedVertexBytes };
+	[[maybe_unused]] float positionError{ 0 };
+	[[maybe_unused]] float normalError{ 0 };
+	for (size_t first{ 0 }; first < vertices.size(); first += chunkVertices) {
+		std::span<const Vertex3D> chunk{ vertices.subspan(first, std::min(chunkVertices, vertices.size() - first)) };
+		VertexAttributes chunkAttributes{ attributesOf(first, chunk.size()) };
+		EncodedVertices encoded{ encodeVertices(chunk, chunkAttributes, COMPACT_ENCODING, quantization) };
+		glBufferSubData(GL_ARRAY_BUFFER, first * stride, encoded.data.size(), encoded.data.data());
+		positionError = std::max(positionError, encoded.positionError);
+		normalError = std::max(normalError, encoded.normalError);
+		cooked.release(std::as_bytes(chunk));
+		cooked.release(std::as_bytes(chunkAttributes.normals));
+		cooked.release(std::as_bytes(chunkAttributes.tangents));
+		cooked.release(std::as_bytes(chunkAttributes.texCoords));
+	}
+	setVertexAttributes(m, layout, attributes, COMPACT_ENCODING);
+
+	uint32_t ebo;
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	size_t indexSize{ m.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t) };
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * indexSize, nullptr, GL_STATIC_DRAW);
+	size_t chunkIndices{ STREAM_CHUNK_BYTES / sizeof(uint32_t) };
+	for (size_t first{ 0 }; first < indices.size(); first += chunkIndices) {
+		std::span<const uint32_t> chunk{ indices.subspan(first, std::min(chunkIndices, indices.size() - first)) };
+		if (m.indexType == GL_UNSIGNED_SHORT) {
+			std::vector<uint16_t> shortChunk{ narrowIndices(chunk) };
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * indexSize, shortChunk.size() * indexSize, shortChunk.data());
+		}
+		else {
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * indexSize, chunk.size_bytes(), chunk.data());
+		}
+		cooked.release(std::as_bytes(chunk));
+	}
+	glBindVertexArray(0);
+
+#ifdef LOG_MESH_STATS
+	std::cout << "Streamed mesh: " << vertices.size() << " vertices, " << indices.size() / VERTICES_PER_FACE
+		<< " faces, " << vertices.size() * stride + indices.size() * indexSize << " bytes in pieces of "
+		<< STREAM_CHUNK_BYTES << ", position error " << positionError << ", normal error " << normalError
+		<< " degrees, " << (m.indexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << std::endl;
+#endif
 	return m;
 }
 
-const size_t VERTICES_PER_FACE = 3;
+// Loads an OBJ file with streamObj, for scans too large for objLoad: each STREAM_CHUNK_BYTES of the
+// file is parsed and copied with glBufferSubData into buffers made at the mesh's full size, so only
+// about that much of it is ever in memory. Welding needs the whole mesh, so vertices are uploaded
+// as the file has them, at full precision.
+Mesh streamObjLoad(const std::string& path) {
+	Mesh m{ describeMesh(0) };
+	glGenVertexArrays(1, &m.vao);
+	glBindVertexArray(m.vao);
+	uint32_t vbo;
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	uint32_t ebo;
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
-// Reads the vertices and faces of an Assimp mesh, and uses them to initialize mesh structures
-// compatible with the rest of our application.
-void fromAssimpMesh(const aiMesh* mesh, std::vector<Vertex3D>& vertices,
-	std::vector<uint32_t>& faces) {
-	for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
-		// Each "vertex" from Assimp has to be transformed into a Vertex3D in our application.
-		vertices.push_back(
-			Vertex3D{ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z }
-		);
+	size_t vertexCount{ 0 };
+	size_t indexCount{ 0 };
+	size_t indexSize{ sizeof(uint32_t) };
+	BoundingBox box{ glm::vec3{ 0 }, glm::vec3{ 0 } };
+	try {
+		streamObj(path, STREAM_CHUNK_BYTES, [&](const ObjCounts& counts) {
+			m.faces = static_cast<uint32_t>(counts.faces);
+			m.submeshes = { Submesh{ 0, m.faces, 0 } };
+			m.indexType = counts.vertices <= UINT16_MAX + 1 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+			indexSize = m.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+			glBufferData(GL_ARRAY_BUFFER, counts.vertices * sizeof(Vertex3D), nullptr, GL_STATIC_DRAW);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, counts.faces * indexSize, nullptr, GL_STATIC_DRAW);
+		}, [&](std::span<const Vertex3D> vertices, std::span<const uint32_t> faces) {
+			glBufferSubData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex3D), vertices.size_bytes(), vertices.data());
+			if (m.indexType == GL_UNSIGNED_SHORT) {
+				std::vector<uint16_t> shortFaces{ narrowIndices(faces) };
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, shortFaces.size() * indexSize,
+					shortFaces.data());
+			}
+			else {
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, faces.size_bytes(), faces.data());
+			}
+			if (!vertices.empty()) {
+				box = vertexCount == 0 ? boundingBox(vertices) : enclose(box, boundingBox(vertices));
+			}
+			vertexCount += vertices.size();
+			indexCount += faces.size();
+		});
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "OBJ ERROR " << e.what() << std::endl;
+		exit(1);
 	}
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex3D), 0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+
+	// The sphere around the box, since a tighter one would take another pass over the vertices.
+	setBounds(m, BoundingVolumes{ box, BoundingSphere{ (box.low + box.high) * 0.5f,
+		glm::length(box.high - box.low) * 0.5f } });
+#ifdef LOG_MESH_STATS
+	std::cout << "Streamed " << path << ": " << vertexCount << " vertices, " << indexCount / VERTICES_PER_FACE
+		<< " faces, " << vertexCount * sizeof(Vertex3D) + indexCount * indexSize << " bytes in pieces of "
+		<< STREAM_CHUNK_BYTES << std::endl;
+#endif
+	return m;
+}
 
-	faces.reserve(mesh->mNumFaces * VERTICES_PER_FACE);
-	for (size_t i{ 0 }; i < mesh->mNumFaces; ++i) {
-		// We assume the faces are triangular, so we push three face indexes at a time into our faces list.
-		faces.push_back(mesh->mFaces[i].mIndices[0]);
-		faces.push_back(mesh->mFaces[i].mIndices[1]);
-		faces.push_back(mesh->mFaces[i].mIndices[2]);
+#ifdef LOG_MESH_TIMES
+void logImportReport(const std::string& path, const MeshImportReport& report) {
+	std::cout << "Imported " << path << " in " << report.total << " ms: read " << report.read << " ms, convert "
+		<< report.convert << " ms, join vertices " << report.joinVertices << " ms, normals "
+		<< report.generateNormals << " ms, tangents " << report.generateTangents << " ms, optimize "
+		<< report.optimize << " ms, meshlets " << report.buildMeshlets
+		<< " ms, LODs " << report.buildLods << " ms" << std::endl;
+	if (report.optimization.analyzed) {
+		const MeshOptimizationReport& optimization{ report.optimization };
+		std::cout << "  ACMR " << optimization.cacheBefore.acmr << " -> " << optimization.cacheAfter.acmr
+			<< ", ATVR " << optimization.cacheBefore.atvr << " -> " << optimization.cacheAfter.atvr
+			<< ", overdraw " << optimization.overdrawBefore << " -> " << optimization.overdrawAfter << ", "
+			<< optimization.degenerateTriangles << " degenerate triangles removed" << std::endl;
 	}
 }
+#endif
 
-// Loads an asset file supported by Assimp, extracts the first mesh in the file, and fills in the 
-// given vertices and faces lists with its data.
+// Loads an asset file supported by Assimp, and uploads all of the meshes in the file as submeshes of
+// one Mesh. The result is cooked into the mesh cache, so later runs map it from there instead of
+// importing the file again.
 Mesh assimpLoad(const std::string& path, bool flipUvs = false) {
-	int flags{ static_cast<aiPostProcessSteps>(aiProcessPreset_TargetRealtime_MaxQuality) };
+	MeshImportProfile profile{ MESH_IMPORT_PROFILE };
 	if (flipUvs) {
-		flags |= aiProcess_FlipUVs;
+		profile.assimpFlags |= aiProcess_FlipUVs;
 	}
+#ifdef LOG_MESH_TIMES
+	profile.analyzeOptimization = true;
+#endif
 
-	Assimp::Importer importer{};
-	const aiScene* scene{ importer.ReadFile(path, flags) };
+	uint64_t cacheKey{ meshCacheKey(path, importProfileKey(profile)) };
+	if (std::optional<CookedMesh> cooked{ CookedMesh::open(cacheKey, path) }) {
+		return streamCookedMesh(*cooked);
+	}
 
-	// If the import failed, report it
-	if (nullptr == scene) {
-		std::cout << "ASSIMP ERROR" << importer.GetErrorString() << std::endl;
-		exit(1);
+	MeshData mesh{};
+	MeshSource source{};
+	try {
+		source = meshSource(path);
+		[[maybe_unused]] MeshImportReport report{ importMesh(path, profile, mesh) };
+#ifdef LOG_MESH_TIMES
+		logImportReport(path, report);
+#endif
 	}
-	else {
-		std::vector<Vertex3D> vertices{};
-		std::vector<uint32_t> faces{};
-		fromAssimpMesh(scene->mMeshes[0], vertices, faces);
-		return constructMesh(vertices, faces);
+	catch (std::runtime_error& e) {
+		// If the import failed, report it
+		std::cout << "ASSIMP ERROR" << e.what() << std::endl;
+		exit(1);
 	}
+	VertexAttributes attributes{ mesh.normals, mesh.tangents, mesh.texCoords };
+	CookedMesh::store(cacheKey, source, mesh.vertices, mesh.faces, mesh.submeshes, mesh.lods, mesh.meshlets, attributes);
+	return constructMesh(mesh.vertices, mesh.faces, mesh.submeshes, mesh.lods, mesh.meshlets, attributes, COMPACT_ENCODING);
 }
 
-void drawMesh(const Mesh& m) {
+// Draws ranges of the mesh's index buffer, such as its submeshes or its visible meshlets.
+void drawRanges(const Mesh& m, std::span<const Submesh> ranges) {
 	glBindVertexArray(m.vao);
 	// Draw the vertex array, using is "element buffer" to identify the faces, and whatever ShaderProgram
-	// has been activated prior to this.
-	glDrawElements(GL_TRIANGLES, m.faces, GL_UNSIGNED_INT, nullptr);
+	// has been activated prior to this. Every range is drawn from the same buffers, so only the
+	// range of indices and the vertex they count from change between draws.
+	size_t indexSize{ m.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t) };
+	for (const Submesh& range : ranges) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, m.indexType,
+			reinterpret_cast<const void*>(range.indexOffset * indexSize), range.baseVertex);
+	}
 	// Deactivate the mesh's vertex array.
 	glBindVertexArray(0);
 }
 
+// Draws the mesh at a level of detail from selectLod: 0 for full detail, or i for m.lods[i - 1].
+void drawMesh(const Mesh& m, size_t lod = 0) {
+	drawRanges(m, lod == 0 ? m.submeshes : m.lods[lod - 1].submeshes);
+}
+
 // A scene of a triangle.
 Mesh triangle() {
 	std::vector<Vertex3D> triangleVertices{
@@ -143,11 +492,253 @@ Mesh triangle() {
 	return m;
 }
 
+// Loads an OBJ file with the native OBJ parser, which skips Assimp's importer and post-processing.
+// Positions the file repeats are welded, since scans often write a vertex per face corner. Files
+// larger than STREAM_OBJ_THRESHOLD are streamed instead, without welding.
+Mesh objLoad(const std::string& path) {
+	std::error_code error;
+	uintmax_t fileSize{ std::filesystem::file_size(path, error) };
+	if (!error && fileSize > STREAM_OBJ_THRESHOLD) {
+		return streamObjLoad(path);
+	}
+	MeshData mesh{};
+	try {
+		loadObj(path, mesh.vertices, mesh.faces);
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "OBJ ERROR " << e.what() << std::endl;
+		exit(1);
+	}
+	weldVertices(mesh, EXACT_WELD);
+	return constructMesh(mesh.vertices, mesh.faces);
+}
+
+// Loads a mesh cooked by meshcook at build time. No importing or parsing happens at runtime.
+Mesh cookedLoad(const std::string& path) {
+	std::optional<CookedMesh> cooked{ CookedMesh::openFile(path) };
+	if (!cooked) {
+		std::cout << "ERROR: " << path << " is missing or out of date; rebuild to cook it" << std::endl;
+		exit(1);
+	}
+	return streamCookedMesh(*cooked);
+}
+
 Mesh bunny() {
-	Mesh obj{ assimpLoad("models/bunny.obj", true) };
+	Mesh obj{ cookedLoad("models/bunny.mesh") };
 	return obj;
 }
 
+#ifdef LOG_MESH_TIMES
+// Times Assimp with its MaxQuality preset, Assimp with the import profile assimpLoad uses, and
+// loadObj: on the bunny, and on the bunny repeated SCALED_COPIES times in a temporary file, standing
+// in for a large scan.
+void benchmarkObjLoader() {
+	const size_t SCALED_COPIES{ 200 };
+	auto time{ [](auto&& load) {
+		auto start{ std::chrono::steady_clock::now() };
+		size_t faces{ load() };
+		double milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+		return std::pair{ milliseconds, faces };
+	} };
+	auto compare{ [&](const std::string& path) {
+		auto [assimpTime, assimpFaces] { time([&] {
+			MeshData mesh{};
+			importMesh(path, ASSIMP_MAX_QUALITY_PROFILE, mesh);
+			return mesh.faces.size() / VERTICES_PER_FACE;
+		}) };
+		MeshImportReport report{};
+		auto [profileTime, profileFaces] { time([&] {
+			MeshData mesh{};
+			report = importMesh(path, MESH_IMPORT_PROFILE, mesh);
+			return mesh.faces.size() / VERTICES_PER_FACE;
+		}) };
+		auto [objTime, objFaces] { time([&] {
+			std::vector<Vertex3D> vertices{};
+			std::vector<uint32_t> faces{};
+			loadObj(path, vertices, faces);
+			return faces.size() / VERTICES_PER_FACE;
+		}) };
+		auto [streamTime, streamFaces] { time([&] {
+			size_t indices{ 0 };
+			streamObj(path, STREAM_CHUNK_BYTES, [](const ObjCounts&) {},
+				[&](std::span<const Vertex3D>, std::span<const uint32_t> faces) {
+					indices += faces.size();
+				});
+			return indices / VERTICES_PER_FACE;
+		}) };
+		std::cout << path << ": Assimp MaxQuality " << assimpTime << " ms (" << assimpFaces << " faces), "
+			<< "import profile " << profileTime << " ms (" << profileFaces << " faces), loadObj "
+			<< objTime << " ms (" << objFaces << " faces), streamObj " << streamTime << " ms (" << streamFaces
+			<< " faces)" << std::endl;
+		logImportReport(path, report);
+	} };
+
+	try {
+		// Only cooked models are copied to the build, so read the originals.
+		std::string bunnyPath{ MODEL_SOURCE_DIR "/bunny.obj" };
+		compare(bunnyPath);
+
+		std::vector<Vertex3D> vertices{};
+		std::vector<uint32_t> faces{};
+		loadObj(bunnyPath, vertices, faces);
+		auto scaledPath{ (std::filesystem::temp_directory_path() / "bunny_scaled.obj").string() };
+		{
+			std::ofstream scaled{ scaledPath };
+			scaled.precision(9);
+			for (size_t copy{ 0 }; copy < SCALED_COPIES; ++copy) {
+				for (const Vertex3D& v : vertices) {
+					scaled << "v " << v.x + copy * 0.2f << ' ' << v.y << ' ' << v.z << '\n';
+				}
+				size_t base{ copy * vertices.size() + 1 };
+				for (size_t i{ 0 }; i < faces.size(); i += VERTICES_PER_FACE) {
+					scaled << "f " << faces[i] + base << ' ' << faces[i + 1] + base << ' ' << faces[i + 2] + base << '\n';
+				}
+			}
+		}
+		compare(scaledPath);
+		std::filesystem::remove(scaledPath);
+
+		// The same copies as a triangle soup, with a vertex for every face corner, as some scanners
+		// write them.
+		MeshData soup{};
+		for (size_t copy{ 0 }; copy < SCALED_COPIES; ++copy) {
+			for (uint32_t index : faces) {
+				Vertex3D v{ vertices[index] };
+				v.x += copy * 0.2f;
+				soup.faces.push_back(static_cast<uint32_t>(soup.vertices.size()));
+				soup.vertices.push_back(v);
+			}
+		}
+		size_t soupVertices{ soup.vertices.size() };
+		auto [weldTime, weldedVertices] { time([&] {
+			weldVertices(soup, EXACT_WELD);
+			return soup.vertices.size();
+		}) };
+		std::cout << "weldVertices: " << soupVertices << " -> " << weldedVertices << " vertices in " << weldTime
+			<< " ms" << std::endl;
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "OBJ benchmark failed: " << e.what() << std::endl;
+	}
+}
+
+// Times generateNormals with each weighting, and generateTangents, on the bunny and on copies of it
+// standing in for larger scans. The bunny has no texture coordinates, so it is given some by
+// wrapping a sphere around it.
+void benchmarkNormals() {
+	auto time{ [](auto&& step) {
+		auto start{ std::chrono::steady_clock::now() };
+		step();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} };
+	try {
+		MeshData bunny{};
+		loadObj(MODEL_SOURCE_DIR "/bunny.obj", bunny.vertices, bunny.faces);
+		weldVertices(bunny, EXACT_WELD);
+		for (size_t copies : { 1, 16, 64 }) {
+			MeshData mesh{};
+			for (size_t copy{ 0 }; copy < copies; ++copy) {
+				uint32_t base{ static_cast<uint32_t>(mesh.vertices.size()) };
+				for (const Vertex3D& v : bunny.vertices) {
+					mesh.vertices.push_back(Vertex3D{ v.x + copy * 0.2f, v.y, v.z });
+					mesh.texCoords.push_back(glm::vec2{ std::atan2(v.z, v.x), std::atan2(v.y, std::hypot(v.x, v.z)) });
+				}
+				for (uint32_t index : bunny.faces) {
+					mesh.faces.push_back(base + index);
+				}
+			}
+			double areaTime{ time([&] { generateNormals(mesh, NormalWeighting::Area); }) };
+			double angleTime{ time([&] { generateNormals(mesh, NormalWeighting::Angle); }) };
+			double tangentTime{ time([&] { generateTangents(mesh); }) };
+			std::cout << "Normals and tangents for " << mesh.vertices.size() << " vertices: area-weighted " << areaTime
+				<< " ms, angle-weighted " << angleTime << " ms, tangents " << tangentTime << " ms" << std::endl;
+		}
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "Normal benchmark failed: " << e.what() << std::endl;
+	}
+}
+
+// Times meshBounds on copies of the bunny, one submesh each, standing in for scans of millions of
+// vertices, next to the scalar loop it replaced.
+void benchmarkBounds() {
+	auto time{ [](auto&& step) {
+		auto start{ std::chrono::steady_clock::now() };
+		step();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} };
+	try {
+		MeshData bunny{};
+		loadObj(MODEL_SOURCE_DIR "/bunny.obj", bunny.vertices, bunny.faces);
+		for (size_t copies : { 1, 64, 256 }) {
+			std::vector<Vertex3D> vertices{};
+			std::vector<Submesh> submeshes{};
+			for (size_t copy{ 0 }; copy < copies; ++copy) {
+				submeshes.push_back(Submesh{ 0, static_cast<uint32_t>(bunny.faces.size()),
+					static_cast<int32_t>(vertices.size()) });
+				for (const Vertex3D& v : bunny.vertices) {
+					vertices.push_back(Vertex3D{ v.x + copy * 0.2f, v.y, v.z });
+				}
+			}
+			MeshBounds bounds{};
+			double boundsTime{ time([&] { bounds = meshBounds(vertices, submeshes); }) };
+			glm::vec3 first{ vertices[0].x, vertices[0].y, vertices[0].z };
+			BoundingBox box{ first, first };
+			double scalarTime{ time([&] {
+				for (const Vertex3D& v : vertices) {
+					box.low = glm::min(box.low, glm::vec3{ v.x, v.y, v.z });
+					box.high = glm::max(box.high, glm::vec3{ v.x, v.y, v.z });
+				}
+			}) };
+			std::cout << "Bounds for " << vertices.size() << " vertices in " << copies << " submeshes: " << boundsTime
+				<< " ms, against " << scalarTime << " ms for a scalar box alone"
+				<< (bounds.mesh.box.low == box.low && bounds.mesh.box.high == box.high ? "" : " (boxes differ)")
+				<< std::endl;
+		}
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "Bounds benchmark failed: " << e.what() << std::endl;
+	}
+}
+
+// Measures what optimizeMesh does to the bunny with its triangles shuffled, as a scan with no useful
+// order would have them: vertex cache efficiency and overdraw before and after, with overdraw
+// reordering and without.
+void benchmarkOptimizer() {
+	try {
+		MeshData bunny{};
+		loadObj(MODEL_SOURCE_DIR "/bunny.obj", bunny.vertices, bunny.faces);
+		weldVertices(bunny, EXACT_WELD);
+		std::vector<size_t> order(bunny.faces.size() / VERTICES_PER_FACE);
+		std::iota(order.begin(), order.end(), size_t{ 0 });
+		std::shuffle(order.begin(), order.end(), std::mt19937{ 1 });
+		std::vector<uint32_t> shuffled{};
+		shuffled.reserve(bunny.faces.size());
+		for (size_t triangle : order) {
+			for (size_t corner{ 0 }; corner < VERTICES_PER_FACE; ++corner) {
+				shuffled.push_back(bunny.faces[triangle * VERTICES_PER_FACE + corner]);
+			}
+		}
+		bunny.faces = std::move(shuffled);
+
+		for (bool optimizeOverdraw : { false, true }) {
+			MeshData mesh{ bunny };
+			auto start{ std::chrono::steady_clock::now() };
+			MeshOptimizationReport report{ optimizeMesh(mesh, optimizeOverdraw, true) };
+			double milliseconds{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+			std::cout << "optimizeMesh on the shuffled bunny" << (optimizeOverdraw ? " with" : " without")
+				<< " overdraw reordering, " << milliseconds << " ms with analysis: ACMR " << report.cacheBefore.acmr
+				<< " -> " << report.cacheAfter.acmr << ", ATVR " << report.cacheBefore.atvr << " -> "
+				<< report.cacheAfter.atvr << ", overdraw " << report.overdrawBefore << " -> " << report.overdrawAfter
+				<< std::endl;
+		}
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "Optimizer benchmark failed: " << e.what() << std::endl;
+	}
+}
+#endif
+
 glm::mat4 buildModelMatrix(const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale) {
 	auto m{ glm::translate(glm::mat4(1), position) };
 	m = glm::scale(m, scale);
@@ -172,24 +763,85 @@ int main() {
 
 	gladLoadGL();
 	glEnable(GL_DEPTH_TEST);
+	// Meshlets whose triangles all face away are skipped before drawing, so skip every other back
+	// face too, or which ones show would depend on how the mesh was clustered. This applies to every
+	// draw, not just the culled ones, so the wireframe doesn't change when the level of detail does.
+	glEnable(GL_CULL_FACE);
 	// Draw in wireframe mode for now.
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 
+	// Start compiling the shader program first, so the driver can work on it while the mesh loads.
+	// Its defines depend on the mesh, so start with the ones imported models need (generating
+	// tangents generates normals too); a mesh that turns out to need others gets its own program
+	// once it has loaded.
+	ShaderRegistry shaders{ readEmbeddedShader };
+	perspectiveShader(shaders, vertexDefines(
+		(MESH_IMPORT_PROFILE.generateNormals || MESH_IMPORT_PROFILE.generateTangents) && COMPACT_ENCODING.octahedralNormals));
+
+#ifdef LOG_MESH_TIMES
+	benchmarkObjLoader();
+	benchmarkNormals();
+	benchmarkBounds();
+	benchmarkOptimizer();
+#endif
+
 	// Inintialize scene objects.
 	Mesh obj{ bunny() };
 	//Mesh obj = triangle();
 	glm::vec3 objectPosition{ 0, 0, -3 };
 	glm::vec3 objectOrientation{ 0, 0, 0 };
 	glm::vec3 objectScale{ 3, 3, 3 };
+	ShaderProgram& program{ perspectiveShader(shaders, vertexDefines(obj)) };
 
 	// Activate the shader program.
-	ShaderProgram program{ perspectiveShader() };
-	program.activate();
+	try {
+		program.activate();
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+#ifdef LOG_SHADER_TIMES
+	const ShaderLoadReport& report{ program.loadReport() };
+	std::cout << "Loaded perspective shader in " << report.milliseconds << " ms ("
+		<< (report.fromBinaryCache ? "program binary cache" : "compiled from source") << ")" << std::endl;
+#ifdef HAS_SPIRV_SHADERS
+	benchmarkSpirv();
+#endif
+#endif
+	// Per-frame and per-draw uniform blocks are written into a ring of frame regions, so the CPU can
+	// prepare the next frames while the GPU draws this one.
+	StreamBuffer uniformStream{ GL_UNIFORM_BUFFER, 64 * 1024 };
+	UniformBuffer cameraBlock{ CAMERA_BLOCK,
+		Std140Layout{}.add("view", UniformType::Mat4).add("projection", UniformType::Mat4) };
+	UniformBuffer objectBlock{ OBJECT_BLOCK, Std140Layout{}.add("model", UniformType::Mat4) };
+	try {
+		cameraBlock.verify(program);
+		objectBlock.verify(program);
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+
+#ifdef SHADER_DISK_OVERRIDE
+	// Recompile the shader program whenever its files in the shaders directory change.
+	ShaderReloader reloader{};
+	reloader.watch(program, "shaders/simple_perspective.vert", "shaders/all_green.frag", vertexDefines(obj));
+#endif
 
 	// Ready, set, go!
 	sf::Clock c;
 
+	// Reused every frame for the meshlets that survive culling.
+	std::vector<Submesh> visibleRanges{};
+#ifdef LOG_MESH_STATS
+	size_t culledFrames{ 0 };
+	size_t culledMeshlets{ 0 };
+	size_t drawnIndices{ 0 };
+#endif
+
 	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
 		// Check for events.
@@ -198,6 +850,11 @@ int main() {
 				window.close();
 			}
 		}
+#ifdef SHADER_DISK_OVERRIDE
+		// Swap in any shader programs that finished recompiling since the last frame.
+		reloader.update();
+#endif
+
 		auto now{ c.getElapsedTime() };
 		auto diff{ now - last };
 		last = now;
@@ -221,16 +878,58 @@ int main() {
 		glm::mat4 perspective{
 			glm::perspective(glm::radians(45.0), static_cast<double>(window.getSize().x) / window.getSize().y, 0.1, 100.0)
 		};
-		program.setUniform("model", model);
-		program.setUniform("view", camera);
-		program.setUniform("projection", perspective);
-
-		// Draw!
+		uniformStream.beginFrame();
+		cameraBlock.set("view", camera);
+		cameraBlock.set("projection", perspective);
+		cameraBlock.upload(uniformStream);
+		// Applies the mesh's dequantization too, which costs nothing extra in the shader.
+		objectBlock.set("model", model * obj.positionTransform);
+		objectBlock.upload(uniformStream);
+		uniformStream.flush();
+
+		// Draw, at the coarsest level of detail that looks the same from here.
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		drawMesh(obj);
+		size_t lod{ selectLod(obj, camera * model, perspective, static_cast<float>(window.getSize().y)) };
+		if (lod == 0 && !obj.meshlets.empty()) {
+			// At full detail, only the meshlets that can be seen.
+			[[maybe_unused]] MeshletCullStats cull{ cullMeshlets(obj, camera * model, perspective, visibleRanges) };
+			drawRanges(obj, visibleRanges);
+#ifdef LOG_MESH_STATS
+			++culledFrames;
+			culledMeshlets += cull.outsideFrustum + cull.facingAway;
+			drawnIndices += cull.indices;
+#endif
+		}
+		else if (lod != LOD_CULLED) {
+			drawMesh(obj, lod);
+		}
+		uniformStream.endFrame();
 		window.display();
 	}
 
+#if defined(LOG_SHADER_TIMES) && defined(SHADER_DISK_OVERRIDE)
+	const ShaderReloadStats& reloadStats{ reloader.stats() };
+	std::cout << "Shader reloads: " << reloadStats.reloads << " (" << reloadStats.failures << " failed), "
+		<< "max latency " << reloadStats.maxLatency << " ms, max frame cost " << reloadStats.maxUpdateTime << " ms"
+		<< std::endl;
+#endif
+
+#ifdef LOG_MESH_STATS
+	if (culledFrames > 0) {
+		std::cout << "Meshlet culling: " << obj.meshlets.size() << " meshlets, " << culledMeshlets / culledFrames
+			<< " culled and " << drawnIndices / culledFrames << " of " << obj.faces << " indices drawn per frame"
+			<< std::endl;
+	}
+#endif
+
+#ifdef LOG_STREAM_STATS
+	const StreamBufferStats& streamStats{ uniformStream.stats() };
+	std::cout << "Uniform stream: " << streamStats.frames << " frames, " << streamStats.fenceWaits
+		<< " waited on the GPU for " << streamStats.waitMilliseconds << " ms, peak "
+		<< streamStats.peakFrameBytes << " bytes per frame ("
+		<< (StreamBuffer::persistentMappingSupported() ? "persistent mapping" : "unsynchronized mapping") << ")" << std::endl;
+#endif
+
 	return 0;
 }
 
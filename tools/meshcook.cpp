@@ -0,0 +1,88 @@
+/*
+* meshcook: converts a model file into a cooked mesh (see MeshCache.h) that the application maps
+* and uploads without importing anything. Run by the build for every file in /models.
+*
+*     meshcook [--analyze] <model file> <cooked mesh>
+*
+* --analyze also reports the vertex cache efficiency and overdraw of the mesh before and after it
+* was optimized. The build doesn't ask for it, as measuring overdraw takes longer than the import.
+*
+* The build only runs meshcook when the model is newer than its cooked mesh. The cooked mesh also
+* records the hash of the model it came from, so a model whose timestamp changed but whose contents
+* didn't (e.g. after a checkout) is not imported again; its cooked mesh is just touched.
+*/
+
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AssimpImport.h"
+#include "MeshCache.h"
+
+int main(int argc, char** argv) {
+	bool analyze{ argc == 4 && std::string_view{ argv[1] } == "--analyze" };
+	if (argc != (analyze ? 4 : 3)) {
+		std::cerr << "usage: meshcook [--analyze] <model file> <cooked mesh>" << std::endl;
+		return 2;
+	}
+	std::string input{ argv[argc - 2] };
+	std::string output{ argv[argc - 1] };
+	MeshImportProfile profile{ MESH_IMPORT_PROFILE };
+	profile.analyzeOptimization = analyze;
+
+	try {
+		uint64_t key{ meshCacheKey(input, importProfileKey(profile)) };
+		if (std::optional<CookedMesh> existing{ CookedMesh::openFile(output) };
+			existing && existing->key() == key && existing->cookedFrom(input)) {
+			existing.reset();
+			std::filesystem::last_write_time(output, std::filesystem::file_time_type::clock::now());
+			std::cout << output << " is up to date" << std::endl;
+			return 0;
+		}
+
+		MeshSource source{ meshSource(input) };
+		MeshData mesh{};
+		MeshImportReport report{ importMesh(input, profile, mesh) };
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path{ output }.parent_path(), error);
+		if (!CookedMesh::write(output, key, source, mesh.vertices, mesh.faces, mesh.submeshes, mesh.lods, mesh.meshlets,
+			VertexAttributes{ mesh.normals, mesh.tangents, mesh.texCoords })) {
+			std::cerr << "meshcook: failed to write " << output << std::endl;
+			return 1;
+		}
+		auto faceCount{ [](const std::vector<Submesh>& submeshes) {
+			size_t indices{ 0 };
+			for (const Submesh& submesh : submeshes) {
+				indices += submesh.indexCount;
+			}
+			return indices / VERTICES_PER_FACE;
+		} };
+		std::cout << "cooked " << input << ": " << mesh.vertices.size() << " vertices, "
+			<< faceCount(mesh.submeshes) << " faces in " << mesh.submeshes.size() << " submeshes, "
+			<< report.total << " ms (read " << report.read << ", convert " << report.convert << ", join "
+			<< report.joinVertices << ", normals " << report.generateNormals << ", tangents " << report.generateTangents
+			<< ", optimize " << report.optimize
+			<< ", meshlets " << report.buildMeshlets << ", LODs " << report.buildLods << ")" << std::endl;
+		const MeshOptimizationReport& optimization{ report.optimization };
+		std::cout << "  ";
+		if (optimization.analyzed) {
+			std::cout << "ACMR " << optimization.cacheBefore.acmr << " -> " << optimization.cacheAfter.acmr
+				<< ", ATVR " << optimization.cacheBefore.atvr << " -> " << optimization.cacheAfter.atvr
+				<< ", overdraw " << optimization.overdrawBefore << " -> " << optimization.overdrawAfter << ", ";
+		}
+		std::cout << optimization.degenerateTriangles << " degenerate triangles removed" << std::endl;
+		std::cout << "  " << mesh.meshlets.size() << " meshlets" << std::endl;
+		for (size_t i{ 0 }; i < mesh.lods.size(); ++i) {
+			std::cout << "  LOD " << i + 1 << ": " << faceCount(mesh.lods[i].submeshes) << " faces, error "
+				<< mesh.lods[i].error << std::endl;
+		}
+	}
+	catch (std::exception& e) {
+		std::cerr << "meshcook: " << input << ": " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}